@@ -0,0 +1,503 @@
+//./ic.h//
+//./checkpoint.h//
+
+#define _DEFAULT_SOURCE
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ic.h"
+#include "checkpoint.h"
+
+// -----------------------------------------------------------------------------
+// Binary Files
+// -----------------------------------------------------------------------------
+
+// Checkpoints and images start with a header, then each constructor (name,
+// arity, first, count) and each definition (name, whether it is defined,
+// size, root, template), then heap terms. Names are a length followed by
+// their bytes. Terms are stored as they are in memory.
+
+static bool write_u64(FILE* file, uint64_t val) {
+  return fwrite(&val, sizeof(val), 1, file) == 1;
+}
+
+static bool write_name(FILE* file, const char* name) {
+  uint64_t len = strlen(name);
+  return write_u64(file, len) && fwrite(name, 1, len, file) == len;
+}
+
+static bool write_terms(FILE* file, const Term* terms, Val count) {
+  return fwrite(terms, sizeof(Term), count, file) == count;
+}
+
+// Writes what follows the header of a file.
+typedef bool (*Writer)(FILE* file, IC* ic, Term root);
+
+// Write a file next to its path and rename it over the path when done.
+// @param what What the file holds, for errors
+// @return 0 on success, -1 on failure
+static int save_file(const char* path, const char* what, Writer write, IC* ic, Term root) {
+  size_t len = strlen(path);
+  char* tmp = (char*)malloc(len + 5);
+  if (!tmp) {
+    fprintf(stderr, "Error: Memory allocation failed\n");
+    return -1;
+  }
+  memcpy(tmp, path, len);
+  memcpy(tmp + len, ".tmp", 5);
+
+  FILE* file = fopen(tmp, "wb");
+  if (!file) {
+    fprintf(stderr, "Error: Could not open file '%s'\n", tmp);
+    free(tmp);
+    return -1;
+  }
+  bool ok = write(file, ic, root);
+  ok = fclose(file) == 0 && ok;
+  if (!ok || rename(tmp, path) != 0) {
+    fprintf(stderr, "Error: Could not write %s '%s'\n", what, path);
+    remove(tmp);
+    free(tmp);
+    return -1;
+  }
+  free(tmp);
+  return 0;
+}
+
+// A file mapped into memory, read from the start.
+typedef struct {
+  const char* at;  // Next byte to read
+  const char* end; // End of the file
+  void* map;
+  size_t size;
+} Reader;
+
+// Map a file into memory.
+// @return False if it could not be opened or mapped
+static bool reader_open(Reader* reader, const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  void* map = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  madvise(map, st.st_size, MADV_SEQUENTIAL);
+  reader->map = map;
+  reader->size = st.st_size;
+  reader->at = (const char*)map;
+  reader->end = reader->at + st.st_size;
+  return true;
+}
+
+static void reader_close(Reader* reader) {
+  munmap(reader->map, reader->size);
+}
+
+static bool read_bytes(Reader* reader, void* dst, size_t len) {
+  if ((size_t)(reader->end - reader->at) < len) {
+    return false;
+  }
+  memcpy(dst, reader->at, len);
+  reader->at += len;
+  return true;
+}
+
+static bool read_u64(Reader* reader, uint64_t* val) {
+  return read_bytes(reader, val, sizeof(*val));
+}
+
+// Read a name into a new buffer.
+// @return The name, or NULL if the file ends first
+static char* read_name(Reader* reader) {
+  uint64_t len;
+  if (!read_u64(reader, &len) || len > 4096) {
+    return NULL;
+  }
+  char* name = (char*)malloc(len + 1);
+  if (!name || !read_bytes(reader, name, len)) {
+    free(name);
+    return NULL;
+  }
+  name[len] = '\0';
+  return name;
+}
+
+static bool read_terms(Reader* reader, Term* terms, uint64_t count) {
+  if (count > (size_t)(reader->end - reader->at) / sizeof(Term)) {
+    return false;
+  }
+  return read_bytes(reader, terms, count * sizeof(Term));
+}
+
+// Check that terms read from a file only point below limit (see
+// ic_term_valid). Cells holding NONE, such as the ends of free lists, are
+// allowed when none_ok is set.
+static bool terms_valid(IC* ic, const Term* terms, Val count, Val limit, bool none_ok) {
+  for (Val i = 0; i < count; i++) {
+    if (!(none_ok && terms[i] == NONE) && !ic_term_valid(ic, terms[i], limit)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Write the constructors and definitions of a context.
+static bool book_write(FILE* file, IC* ic) {
+  for (Val i = 0; i < ic->ctr_count; i++) {
+    ICCtr* ctr = &ic->ctrs[i];
+    if (!write_name(file, ctr->name) || !write_u64(file, ctr->arity) ||
+        !write_u64(file, ctr->first) || !write_u64(file, ctr->count)) {
+      return false;
+    }
+  }
+  for (Val i = 0; i < ic->def_count; i++) {
+    ICDef* def = &ic->defs[i];
+    if (!write_name(file, def->name) || !write_u64(file, def->terms != NULL) ||
+        !write_u64(file, def->size) || !write_u64(file, def->root)) {
+      return false;
+    }
+    if (def->terms && !write_terms(file, def->terms, def->size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Declare the constructors and definitions written by book_write.
+// @return False if the file is truncated or inconsistent
+static bool book_read(Reader* reader, IC* ic, uint64_t ctr_count, uint64_t def_count) {
+  // Constructors are declared a data type at a time, like the parser does
+  for (Val i = 0; i < ctr_count; ) {
+    uint64_t first = i, count = 1;
+    const char* names[IC_CTR_MAX];
+    Val arities[IC_CTR_MAX];
+    for (Val j = 0; j < count; j++) {
+      uint64_t arity;
+      char* name = read_name(reader);
+      if (!name || !read_u64(reader, &arity) || !read_u64(reader, &first) || !read_u64(reader, &count) ||
+          first != i || count == 0 || i + count > ctr_count || count > IC_CTR_MAX) {
+        free(name);
+        for (Val k = 0; k < j; k++) {
+          free((char*)names[k]);
+        }
+        return false;
+      }
+      names[j] = name;
+      arities[j] = arity;
+    }
+    Val got = ic_ctr_declare(ic, names, arities, count);
+    for (Val j = 0; j < count; j++) {
+      free((char*)names[j]);
+    }
+    if (got != i) {
+      return false;
+    }
+    i += count;
+  }
+
+  for (Val i = 0; i < def_count; i++) {
+    uint64_t defined, size, root;
+    char* name = read_name(reader);
+    if (!name || !read_u64(reader, &defined) || !read_u64(reader, &size) || !read_u64(reader, &root)) {
+      free(name);
+      return false;
+    }
+    Val id = ic_def_declare(ic, name);
+    free(name);
+    if (id != i) {
+      return false;
+    }
+    ICDef* def = &ic->defs[id];
+    if (defined) {
+      if (size > (size_t)(reader->end - reader->at) / sizeof(Term)) {
+        return false;
+      }
+      def->terms = (Term*)malloc((size ? size : 1) * sizeof(Term));
+      if (!def->terms || !read_terms(reader, def->terms, size)) {
+        return false;
+      }
+      def->size = size;
+      def->root = (Term)root;
+    }
+  }
+
+  // Templates can refer to any definition, so they are checked once all are declared
+  for (Val i = 0; i < def_count; i++) {
+    ICDef* def = &ic->defs[i];
+    if (def->terms && (!terms_valid(ic, def->terms, def->size, def->size, false) ||
+                       !ic_term_valid(ic, def->root, def->size))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+// Checkpoint Files
+// -----------------------------------------------------------------------------
+
+// After the book, a checkpoint holds the used heap and stack.
+#define IC_CHECKPOINT_MAGIC 0x4B434349 // "ICCK"
+#define IC_CHECKPOINT_VERSION 1
+
+// Header of a checkpoint file: the context's counters and positions.
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t term_size;     // sizeof(Term) of the build that wrote it
+  uint32_t reuse;         // Whether consumed nodes are recycled
+  uint64_t heap_pos;
+  uint64_t heap_waste;
+  uint64_t stack_pos;
+  uint64_t interactions;
+  uint64_t susp_next;
+  uint64_t susp_stop;
+  uint64_t susp_base;
+  uint64_t free_list[4];
+  uint64_t ctr_count;
+  uint64_t def_count;
+} Header;
+
+// Write the parts of a checkpoint in order.
+static bool checkpoint_write(FILE* file, IC* ic, Term root) {
+  (void)root;
+  Header hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = IC_CHECKPOINT_MAGIC;
+  hdr.version = IC_CHECKPOINT_VERSION;
+  hdr.term_size = sizeof(Term);
+  hdr.reuse = ic->reuse;
+  hdr.heap_pos = ic->heap_pos;
+  hdr.heap_waste = ic->heap_waste;
+  hdr.stack_pos = ic->stack_pos;
+  hdr.interactions = ic->interactions;
+  hdr.susp_next = ic->susp_next;
+  hdr.susp_stop = ic->susp_stop;
+  hdr.susp_base = ic->susp_base;
+  for (Val i = 0; i < 4; i++) {
+    hdr.free_list[i] = ic->free_list[i];
+  }
+  hdr.ctr_count = ic->ctr_count;
+  hdr.def_count = ic->def_count;
+  return fwrite(&hdr, sizeof(hdr), 1, file) == 1 && book_write(file, ic) &&
+         write_terms(file, ic->heap, ic->heap_pos) && write_terms(file, ic->stack, ic->stack_pos);
+}
+
+// Write a checkpoint of a context to a file.
+// @param ic The IC context
+// @param path The checkpoint file
+// @return 0 on success, -1 on failure
+int ic_checkpoint_save(IC* ic, const char* path) {
+  return save_file(path, "checkpoint", checkpoint_write, ic, 0);
+}
+
+// Write a checkpoint from a forked copy of the process.
+// @param ic The IC context
+// @param path The checkpoint file
+// @return The id of the writing process, or -1 if it could not be started
+pid_t ic_checkpoint_fork(IC* ic, const char* path) {
+  fflush(NULL); // Or the child would flush the parent's buffers again
+  pid_t pid = fork();
+  if (pid == 0) {
+    _exit(ic_checkpoint_save(ic, path) == 0 ? 0 : 1);
+  }
+  if (pid < 0) {
+    fprintf(stderr, "Warning: Could not start writing checkpoint '%s'\n", path);
+  }
+  return pid;
+}
+
+// Wait for a checkpoint written by ic_checkpoint_fork.
+// @param pid The id of the writing process
+// @param block Whether to wait if it is still being written
+// @return 0 if it was written, 1 if it is still being written, -1 if it failed
+int ic_checkpoint_wait(pid_t pid, bool block) {
+  int status;
+  pid_t got = waitpid(pid, &status, block ? 0 : WNOHANG);
+  if (got == 0) {
+    return 1;
+  }
+  return got == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+// Read the parts of a checkpoint that follow its header, in order.
+// @return False if the file is truncated or inconsistent
+static bool checkpoint_read(Reader* reader, IC* ic, Header hdr) {
+  if (!book_read(reader, ic, hdr.ctr_count, hdr.def_count) ||
+      !read_terms(reader, ic->heap, hdr.heap_pos) || !read_terms(reader, ic->stack, hdr.stack_pos)) {
+    return false;
+  }
+
+  // Every location must lie in the used heap or stack
+  if (!terms_valid(ic, ic->heap, hdr.heap_pos, hdr.heap_pos, true) ||
+      !terms_valid(ic, ic->stack, hdr.stack_pos, hdr.heap_pos, false) ||
+      hdr.heap_waste > hdr.heap_pos || hdr.susp_stop > hdr.stack_pos ||
+      (hdr.susp_base != NONE && hdr.susp_base > hdr.stack_pos) ||
+      ((Term)hdr.susp_next != NONE && !ic_term_valid(ic, (Term)hdr.susp_next, hdr.heap_pos))) {
+    return false;
+  }
+  for (Val i = 1; i < 4; i++) {
+    if (hdr.free_list[i] != NONE && (hdr.free_list[i] >= hdr.heap_pos || i > hdr.heap_pos - hdr.free_list[i])) {
+      return false;
+    }
+  }
+  ic->reuse = hdr.reuse;
+  ic->heap_pos = hdr.heap_pos;
+  ic->heap_waste = hdr.heap_waste;
+  ic->stack_pos = hdr.stack_pos;
+  ic->interactions = hdr.interactions;
+  ic->susp_next = (Term)hdr.susp_next;
+  ic->susp_stop = hdr.susp_stop;
+  ic->susp_base = hdr.susp_base;
+  for (Val i = 0; i < 4; i++) {
+    ic->free_list[i] = hdr.free_list[i];
+  }
+  return true;
+}
+
+// Load a checkpoint into a new context.
+// @param ic The IC context, with nothing parsed or allocated yet
+// @param path The checkpoint file
+// @return 0 on success, -1 on failure
+int ic_checkpoint_load(IC* ic, const char* path) {
+  Reader reader;
+  if (!reader_open(&reader, path)) {
+    fprintf(stderr, "Error: Could not open file '%s'\n", path);
+    return -1;
+  }
+
+  Header hdr;
+  int result = -1;
+  if (!read_bytes(&reader, &hdr, sizeof(hdr)) || hdr.magic != IC_CHECKPOINT_MAGIC) {
+    fprintf(stderr, "Error: '%s' is not a checkpoint\n", path);
+  } else if (hdr.version != IC_CHECKPOINT_VERSION || hdr.term_size != sizeof(Term)) {
+    fprintf(stderr, "Error: Checkpoint '%s' was written by another build\n", path);
+  } else if (hdr.heap_pos > ic->heap_size || hdr.stack_pos > ic->stack_size) {
+    fprintf(stderr, "Error: Checkpoint '%s' needs a heap of %llu and a stack of %llu terms\n",
+            path, (unsigned long long)hdr.heap_pos, (unsigned long long)hdr.stack_pos);
+  } else if (!checkpoint_read(&reader, ic, hdr)) {
+    fprintf(stderr, "Error: Checkpoint '%s' is truncated or corrupt\n", path);
+  } else {
+    result = 0;
+  }
+  reader_close(&reader);
+  return result;
+}
+
+// -----------------------------------------------------------------------------
+// Program Images
+// -----------------------------------------------------------------------------
+
+// After the book, an image holds the heap segment of the parsed term, whose
+// locations start at 0.
+#define IC_IMAGE_MAGIC 0x42434349 // "ICCB"
+#define IC_IMAGE_VERSION 1
+
+// Header of an image file.
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t term_size;     // sizeof(Term) of the build that wrote it
+  uint32_t unused;
+  uint64_t size;          // Terms in the heap segment
+  uint64_t root;
+  uint64_t ctr_count;
+  uint64_t def_count;
+} ImageHeader;
+
+// Write the parts of an image in order.
+static bool image_write(FILE* file, IC* ic, Term root) {
+  ImageHeader hdr;
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.magic = IC_IMAGE_MAGIC;
+  hdr.version = IC_IMAGE_VERSION;
+  hdr.term_size = sizeof(Term);
+  hdr.size = ic->heap_pos;
+  hdr.root = root;
+  hdr.ctr_count = ic->ctr_count;
+  hdr.def_count = ic->def_count;
+  return fwrite(&hdr, sizeof(hdr), 1, file) == 1 && book_write(file, ic) &&
+         write_terms(file, ic->heap, ic->heap_pos);
+}
+
+// Write a parsed program to an image file.
+// @param ic The IC context
+// @param root The parsed term
+// @param path The image file
+// @return 0 on success, -1 on failure
+int ic_image_save(IC* ic, Term root, const char* path) {
+  return save_file(path, "image", image_write, ic, root);
+}
+
+// Check whether a file starts like an image.
+// @param path The file
+// @return True if it is an image
+bool ic_image_is(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+  uint32_t magic = 0;
+  bool is = fread(&magic, sizeof(magic), 1, file) == 1 && magic == IC_IMAGE_MAGIC;
+  fclose(file);
+  return is;
+}
+
+// Load an image into a context, allocating its heap segment.
+// @return The root term, or NONE if the file is truncated or inconsistent
+static Term image_read(Reader* reader, IC* ic, ImageHeader hdr) {
+  if (!book_read(reader, ic, hdr.ctr_count, hdr.def_count)) {
+    return NONE;
+  }
+  Val loc = ic_alloc(ic, hdr.size);
+  Term* heap = ic->heap + loc;
+  Term root = (Term)hdr.root;
+  if (!read_terms(reader, heap, hdr.size) || !terms_valid(ic, heap, hdr.size, hdr.size, false) ||
+      !ic_term_valid(ic, root, hdr.size)) {
+    return NONE;
+  }
+  if (loc == 0) {
+    return root;
+  }
+  // Move the segment's pointers to where it was allocated
+  for (Val i = 0; i < hdr.size; i++) {
+    Term term = heap[i];
+    heap[i] = ic_has_loc(term) ? term + loc : term;
+  }
+  return ic_has_loc(root) ? root + loc : root;
+}
+
+// Load a program from an image file.
+// @param ic The IC context, with nothing parsed yet
+// @param path The image file
+// @return The parsed term, or NONE on failure
+Term ic_image_load(IC* ic, const char* path) {
+  Reader reader;
+  if (!reader_open(&reader, path)) {
+    fprintf(stderr, "Error: Could not open file '%s'\n", path);
+    return NONE;
+  }
+
+  ImageHeader hdr;
+  Term root = NONE;
+  if (!read_bytes(&reader, &hdr, sizeof(hdr)) || hdr.magic != IC_IMAGE_MAGIC) {
+    fprintf(stderr, "Error: '%s' is not an image\n", path);
+  } else if (hdr.version != IC_IMAGE_VERSION || hdr.term_size != sizeof(Term)) {
+    fprintf(stderr, "Error: Image '%s' was written by another build\n", path);
+  } else if (hdr.size > ic->heap_size - ic->heap_pos) {
+    fprintf(stderr, "Error: Image '%s' needs a heap of %llu terms\n", path, (unsigned long long)hdr.size);
+  } else if ((root = image_read(&reader, ic, hdr)) == NONE) {
+    fprintf(stderr, "Error: Image '%s' is truncated or corrupt\n", path);
+  }
+  reader_close(&reader);
+  return root;
+}
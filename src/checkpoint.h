@@ -0,0 +1,65 @@
+//./checkpoint.c//
+
+#ifndef IC_CHECKPOINT_H
+#define IC_CHECKPOINT_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+#include "ic.h"
+
+// Write a checkpoint of a context to a file: its constructors and
+// definitions, the used part of the heap and stack, and the state of a
+// suspended reduction (see ic_normal_fuel), which ic_checkpoint_load brings
+// back. The file is written next to the path and renamed over it when done,
+// so an interrupted write leaves the previous checkpoint in place. Terms are
+// stored as they are in memory, so only the same build can read them.
+// @param ic The IC context
+// @param path The checkpoint file
+// @return 0 on success, -1 on failure
+int ic_checkpoint_save(IC* ic, const char* path);
+
+// Write a checkpoint from a forked copy of the process, so the caller can go
+// on reducing while it is written; the pages it changes meanwhile are copied
+// by the kernel. The context must not be reduced by other threads.
+// @param ic The IC context
+// @param path The checkpoint file
+// @return The id of the writing process, or -1 if it could not be started
+pid_t ic_checkpoint_fork(IC* ic, const char* path);
+
+// Wait for a checkpoint written by ic_checkpoint_fork.
+// @param pid The id of the writing process
+// @param block Whether to wait if it is still being written
+// @return 0 if it was written, 1 if it is still being written, -1 if it failed
+int ic_checkpoint_wait(pid_t pid, bool block);
+
+// Load a checkpoint into a new context, whose heap and stack must be large
+// enough to hold it. A suspended reduction is resumed by calling
+// ic_normal_fuel with NONE.
+// @param ic The IC context, with nothing parsed or allocated yet
+// @param path The checkpoint file
+// @return 0 on success, -1 on failure
+int ic_checkpoint_load(IC* ic, const char* path);
+
+// Write a parsed program to an image file: its constructors and definitions
+// and the heap segment of its term, so that ic_image_load can bring it back
+// without parsing. Like checkpoints, images only load on the same build.
+// @param ic The IC context, with nothing but the program allocated
+// @param root The parsed term
+// @param path The image file
+// @return 0 on success, -1 on failure
+int ic_image_save(IC* ic, Term root, const char* path);
+
+// Check whether a file starts like an image.
+// @param path The file
+// @return True if it is an image
+bool ic_image_is(const char* path);
+
+// Load a program from an image file. The file is mapped into memory and its
+// heap segment copied to the next free heap location, its pointers moved
+// there unless that is location 0.
+// @param ic The IC context, with no constructors or definitions yet
+// @param path The image file
+// @return The parsed term, or NONE on failure
+Term ic_image_load(IC* ic, const char* path);
+
+#endif // IC_CHECKPOINT_H
@@ -6,6 +6,7 @@
 
 #include "ic.h"
 #include "collapse.h"
+#include "parallel.h"
 #include "show.h"
 
 // -----------------------------------------------------------------------------
@@ -212,7 +213,7 @@ static inline Term ic_sup_sup_y(IC* ic, Term outer_sup, Term inner_sup) {
 static inline Term ic_dup_var(IC* ic, Term dup, Term var) {
   ic->interactions++;
   Val dup_loc = TERM_VAL(dup);
-  ic->heap[dup_loc] = ic_make_sub(var);
+  __atomic_store_n(&ic->heap[dup_loc], ic_make_sub(var), __ATOMIC_RELEASE);
   return var;
 }
 
@@ -263,10 +264,10 @@ static inline Term ic_dup_app(IC* ic, Term dup, Term app) {
 
   // Set substitution and return
   if (is_co0) {
-    ic->heap[dup_loc] = ic_make_sub(app1);
+    __atomic_store_n(&ic->heap[dup_loc], ic_make_sub(app1), __ATOMIC_RELEASE);
     return app0;
   } else {
-    ic->heap[dup_loc] = ic_make_sub(app0);
+    __atomic_store_n(&ic->heap[dup_loc], ic_make_sub(app0), __ATOMIC_RELEASE);
     return app1;
   }
 }
@@ -371,59 +372,164 @@ static inline Term ic_sup_swi_s(IC* ic, Term swi, Term sup) {
 // Collapser
 // -----------------------------------------------------------------------------
 
-Term ic_collapse_sups(IC* ic, Term term) {
-  TermTag tag;
-  Lab lab;
-  Val loc;
+// Both collapsers walk the term iteratively. Each term whose fields are being
+// collapsed has a frame on ic->stack: the term, followed by the index of its
+// next field as a NUM. A collapsed field is written back into its parent.
+// When a rule fires on a finished term, the frame is replaced by one for the
+// result, which is then collapsed in the same place.
+//
+// The SUP collapser marks the nodes it finished in a bitmap over the heap.
+// Most rules move finished fields into their result unchanged, so only the
+// nodes they allocate are walked again. SUP-LAM is the exception: it
+// substitutes its variable somewhere inside its body, so the marks under the
+// body are cleared first. Threads collapsing separate branches share the
+// bitmap, so it is updated atomically.
+
+// #C{a,&L{x0,x1},b}
+// ------------------------------- SUP-CTR
+// !&L{a0,a1} = a
+// !&L{b0,b1} = b
+// &L{#C{a0,x0,b0},#C{a1,x1,b1}}
+static inline Term ic_sup_ctr(IC* ic, Term ctr, Val idx) {
+  ic->interactions++;
+
+  Val ctr_loc = TERM_VAL(ctr);
+  Val cid = CTR_CID(ctr);
+  Val ari = CTR_ARI(ctr);
+  Term sup = ic->heap[ctr_loc + idx];
+  Val sup_loc = TERM_VAL(sup);
+  Lab sup_lab = TERM_LAB(sup);
+
+  // Allocate the two constructors, duplicating every other field
+  Val ctr0_loc = ic_alloc(ic, ari);
+  Val ctr1_loc = ic_alloc(ic, ari);
+  for (Val i = 0; i < ari; i++) {
+    if (i == idx) {
+      ic->heap[ctr0_loc + i] = ic->heap[sup_loc + 0];
+      ic->heap[ctr1_loc + i] = ic->heap[sup_loc + 1];
+    } else {
+      Val dup_loc = ic_alloc(ic, 1);
+      ic->heap[dup_loc] = ic->heap[ctr_loc + i];
+      ic->heap[ctr0_loc + i] = ic_make_co0(sup_lab, dup_loc);
+      ic->heap[ctr1_loc + i] = ic_make_co1(sup_lab, dup_loc);
+    }
+  }
 
-  term = ic_whnf(ic, term);
-  tag = TERM_TAG(term);
-  lab = TERM_LAB(term);
-  loc = TERM_VAL(term);
+  // Create result SUP &L{ctr0, ctr1}
+  Val result_sup_loc = ic_alloc(ic, 2);
+  ic->heap[result_sup_loc + 0] = ic_make_ctr(cid, ari, ctr0_loc);
+  ic->heap[result_sup_loc + 1] = ic_make_ctr(cid, ari, ctr1_loc);
+  return ic_make_sup(sup_lab, result_sup_loc);
+}
+
+// Push a frame for a term that was just reduced to WHNF.
+static inline void ic_collapse_push(IC* ic, Term term) {
+  ic->stack[ic->stack_pos++] = term;
+  ic->stack[ic->stack_pos++] = ic_make_num(0);
+}
 
+// Check whether a term in WHNF may be reducible again after its fields were
+// collapsed: an eliminator whose first field became a SUP or an ERA.
+static inline bool ic_collapse_stale(IC* ic, Term term) {
+  TermTag tag = TERM_TAG(term);
+  if (tag != APP && tag != SUC && tag != SWI && tag != OP2 && !IS_MAT(tag)) {
+    return false;
+  }
+  Term head = ic->heap[TERM_VAL(term)];
+  return IS_SUP(TERM_TAG(head)) || ic_is_era(head);
+}
+
+// Get the number of fields that ic_collapse_sups visits.
+static inline Val ic_collapse_sups_arity(Term term) {
+  TermTag tag = TERM_TAG(term);
   if (tag == LAM) {
-    ic->heap[loc+0] = ic_collapse_sups(ic, ic->heap[loc+0]);
-  } else if (tag == APP) {
-    ic->heap[loc+0] = ic_collapse_sups(ic, ic->heap[loc+0]);
-    ic->heap[loc+1] = ic_collapse_sups(ic, ic->heap[loc+1]);
-  } else if (IS_SUP(tag)) {
-    ic->heap[loc+0] = ic_collapse_sups(ic, ic->heap[loc+0]);
-    ic->heap[loc+1] = ic_collapse_sups(ic, ic->heap[loc+1]);
+    return 1;
+  } else if (tag == APP || IS_SUP(tag)) {
+    return 2;
+  } else if (IS_CTR(tag)) {
+    return CTR_ARI(term);
+  } else {
+    return 0;
+  }
+}
+
+// Check whether a term is a node that ic_collapse_sups already finished.
+static inline bool ic_collapse_done(uint64_t* done, Term term) {
+  Val loc = TERM_VAL(term);
+  return ic_collapse_sups_arity(term) > 0 && ((__atomic_load_n(&done[loc / 64], __ATOMIC_RELAXED) >> (loc % 64)) & 1);
+}
+
+// Mark a finished node.
+static inline void ic_collapse_mark(uint64_t* done, Term term) {
+  if (ic_collapse_sups_arity(term) > 0) {
+    Val loc = TERM_VAL(term);
+    __atomic_fetch_or(&done[loc / 64], 1ULL << (loc % 64), __ATOMIC_RELAXED);
   }
+}
+
+// Clear the marks of the finished nodes under a term, so that they are
+// walked again. Uses the free part of ic->stack.
+static void ic_collapse_unmark(IC* ic, uint64_t* done, Term term) {
+  Term* stack = ic->stack;
+  Val base = ic->stack_pos;
+  Val pos = base;
+  stack[pos++] = term;
+  while (pos > base) {
+    term = stack[--pos];
+    if (!ic_collapse_done(done, term)) {
+      continue;
+    }
+    Val loc = TERM_VAL(term);
+    __atomic_fetch_and(&done[loc / 64], ~(1ULL << (loc % 64)), __ATOMIC_RELAXED);
+    for (Val i = 0; i < ic_collapse_sups_arity(term); i++) {
+      stack[pos++] = ic->heap[loc + i];
+    }
+  }
+}
 
-  term = ic_whnf(ic, term);
-  tag = TERM_TAG(term);
-  lab = TERM_LAB(term);
-  loc = TERM_VAL(term);
+// Apply a SUP/ERA lifting rule to a term whose fields were collapsed.
+// @return The result, or NONE if no rule applies
+static Term ic_collapse_sups_rule(IC* ic, uint64_t* done, Term term) {
+  TermTag tag = TERM_TAG(term);
+  Lab lab = TERM_LAB(term);
+  Val loc = TERM_VAL(term);
 
   if (tag == LAM) {
     Term bod_col = ic->heap[loc+0];
     if (IS_SUP(TERM_TAG(bod_col))) {
       //printf(">> SUP-LAM\n");
-      return ic_collapse_sups(ic, ic_sup_lam(ic, term, bod_col));
+      ic_collapse_unmark(ic, done, bod_col);
+      return ic_sup_lam(ic, term, bod_col);
     } else if (ic_is_era(bod_col)) {
       //printf(">> ERA-LAM\n");
-      return ic_collapse_sups(ic, ic_era_lam(ic, term, bod_col));
+      return ic_era_lam(ic, term, bod_col);
     }
   } else if (tag == APP) {
     Term fun_col = ic->heap[loc+0];
     Term arg_col = ic->heap[loc+1];
     if (IS_SUP(TERM_TAG(arg_col))) {
       //printf(">> SUP-APP\n");
-      return ic_collapse_sups(ic, ic_sup_app(ic, term, arg_col));
+      return ic_sup_app(ic, term, arg_col);
     } else if (ic_is_era(arg_col)) {
       //printf(">> ERA-APP\n");
-      return ic_collapse_sups(ic, ic_era_app(ic, term, arg_col));
+      return ic_era_app(ic, term, arg_col);
     }
   } else if (IS_SUP(tag)) {
     Term lft_col = ic->heap[loc+0];
     Term rgt_col = ic->heap[loc+1];
     if (IS_SUP(TERM_TAG(lft_col)) && lab > TERM_LAB(lft_col)) {
       //printf(">> SUP-SUP-X\n");
-      return ic_collapse_sups(ic, ic_sup_sup_x(ic, term, lft_col));
+      return ic_sup_sup_x(ic, term, lft_col);
     } else if (IS_SUP(TERM_TAG(rgt_col)) && lab > TERM_LAB(rgt_col)) {
       //printf(">> SUP-SUP-Y\n");
-      return ic_collapse_sups(ic, ic_sup_sup_y(ic, term, rgt_col));
+      return ic_sup_sup_y(ic, term, rgt_col);
+    }
+  } else if (IS_CTR(tag)) {
+    for (Val i = 0; i < CTR_ARI(term); i++) {
+      if (IS_SUP(TERM_TAG(ic->heap[loc+i]))) {
+        //printf(">> SUP-CTR\n");
+        return ic_sup_ctr(ic, term, i);
+      }
     }
   } else if (tag == SWI) {
     Term num = ic->heap[loc+0];
@@ -432,59 +538,352 @@ Term ic_collapse_sups(IC* ic, Term term) {
 
     if (IS_SUP(TERM_TAG(ifz))) {
       //printf(">> SUP-SWI-Z\n");
-      return ic_collapse_sups(ic, ic_sup_swi_z(ic, term, ifz));
+      return ic_sup_swi_z(ic, term, ifz);
     } else if (IS_SUP(TERM_TAG(ifs))) {
       //printf(">> SUP-SWI-S\n");
-      return ic_collapse_sups(ic, ic_sup_swi_s(ic, term, ifs));
+      return ic_sup_swi_s(ic, term, ifs);
     }
   }
 
+  return NONE;
+}
+
+// Allocate the bitmap of finished nodes, one bit per heap location.
+static uint64_t* ic_collapse_marks(IC* ic) {
+  uint64_t* done = (uint64_t*)calloc(ic->heap_size / 64 + 1, sizeof(uint64_t));
+  if (!done) {
+    fprintf(stderr, "Error: Memory allocation failed during collapse\n");
+    exit(1);
+  }
+  return done;
+}
+
+// Lift the SUPs of a term to the top. A lazy collapse does not walk into the
+// branches of a SUP, so it stops as soon as one reaches the top.
+// The caller turns off node reuse, since a node freed here could be
+// allocated again while still marked.
+static Term ic_collapse_sups_go(IC* ic, Term term, uint64_t* done, bool lazy) {
+  Term* stack = ic->stack;
+  Val base = ic->stack_pos;
+  ic_collapse_push(ic, ic_whnf(ic, term));
+
+  while (1) {
+    Val top = ic->stack_pos;
+    term = stack[top - 2];
+    Val idx = TERM_VAL(stack[top - 1]);
+    bool branch = lazy && IS_SUP(TERM_TAG(term));
+
+    // Collapse the next field, unless it is already finished
+    if (!branch && idx < ic_collapse_sups_arity(term)) {
+      stack[top - 1] = ic_make_num(idx + 1);
+      Term field = ic->heap[TERM_VAL(term) + idx];
+      if (!ic_collapse_done(done, field)) {
+        ic_collapse_push(ic, ic_whnf(ic, field));
+      }
+      continue;
+    }
+
+    // All fields collapsed: a SUP or ERA that reached the head of an
+    // eliminator interacts with it, and the result is collapsed in its place
+    ic->stack_pos -= 2;
+    if (ic_collapse_stale(ic, term)) {
+      Term red = ic_whnf(ic, term);
+      if (red != term) {
+        ic_collapse_push(ic, red);
+        continue;
+      }
+    }
+
+    // Lift a SUP or ERA out of this term, if possible
+    if (!branch) {
+      Term res = ic_collapse_sups_rule(ic, done, term);
+      if (res != NONE) {
+        ic_collapse_push(ic, ic_whnf(ic, res));
+        continue;
+      }
+      ic_collapse_mark(done, term);
+    }
+
+    // Done: return it to the parent
+    if (ic->stack_pos == base) {
+      return term;
+    }
+    Val parent_idx = TERM_VAL(stack[ic->stack_pos - 1]) - 1;
+    ic->heap[TERM_VAL(stack[ic->stack_pos - 2]) + parent_idx] = term;
+  }
+}
+
+Term ic_collapse_sups(IC* ic, Term term) {
+  uint64_t* done = ic_collapse_marks(ic);
+  bool reuse = ic->reuse;
+  ic->reuse = false;
+  term = ic_collapse_sups_go(ic, term, done, false);
+  ic->reuse = reuse;
+  free(done);
   return term;
 }
 
-Term ic_collapse_dups(IC* ic, Term term) {
-  term = ic_whnf(ic, term);
+// Get the number of fields that ic_collapse_dups visits. The field of a
+// duplication is the value in its node.
+static inline Val ic_collapse_dups_arity(Term term) {
   TermTag tag = TERM_TAG(term);
+  if (tag == LAM || tag == SUC || IS_DUP(tag)) {
+    return 1;
+  } else if (tag == APP || IS_SUP(tag) || tag == OP2) {
+    return 2;
+  } else if (tag == SWI) {
+    return 3;
+  } else if (IS_CTR(tag)) {
+    return CTR_ARI(term);
+  } else if (IS_MAT(tag)) {
+    return MAT_LEN(term) + 2;
+  } else {
+    return 0;
+  }
+}
+
+// Lift a duplication over its value, if possible.
+// @return The result, or NONE if no rule applies
+static Term ic_collapse_dups_rule(IC* ic, Term term) {
+  if (!IS_DUP(TERM_TAG(term))) {
+    return NONE;
+  }
+
+  // Worker threads may reach both sides of a duplication at once. The rules
+  // release the node by substituting it.
   Val loc = TERM_VAL(term);
-  if (IS_DUP(tag)) {
-    // Get the value this collapser points to
-    Term val = ic_collapse_dups(ic, ic->heap[loc]);
-    TermTag val_tag = TERM_TAG(val);
-    if (val_tag == VAR) {
-      //printf(">> DUP-VAR\n");
-      return ic_collapse_dups(ic, ic_dup_var(ic, term, val));
-    } else if (val_tag == APP) {
-      //printf(">> DUP-APP\n");
-      return ic_collapse_dups(ic, ic_dup_app(ic, term, val));
-    } else if (ic_is_era(val)) {
-      //printf(">> DUP-ERA\n");
-      return ic_collapse_dups(ic, ic_dup_era(ic, term, val));
-    } else {
+  Term val = ic->parent ? ic_dup_lock(ic, loc) : ic->heap[loc];
+  if (TERM_SUB(val)) {
+    return ic_clear_sub(val);
+  }
+
+  // Put back a value moved by ic_erase, since the rules below read and
+  // substitute the node itself. The erased half is then left to the collector.
+  Val at = ic_dup_node(ic, loc);
+  if (at != loc) {
+    val = ic->heap[at];
+    ic->heap[loc] = val;
+  }
+
+  TermTag val_tag = TERM_TAG(val);
+  if (val_tag == VAR) {
+    //printf(">> DUP-VAR\n");
+    return ic_dup_var(ic, term, val);
+  } else if (val_tag == APP) {
+    //printf(">> DUP-APP\n");
+    return ic_dup_app(ic, term, val);
+  } else if (ic_is_era(val)) {
+    //printf(">> DUP-ERA\n");
+    return ic_dup_era(ic, term, val);
+  }
+  if (ic->parent) {
+    __atomic_store_n(&ic->heap[loc], val, __ATOMIC_RELEASE);
+  }
+  return NONE;
+}
+
+Term ic_collapse_dups(IC* ic, Term term) {
+  Term* stack = ic->stack;
+  Val base = ic->stack_pos;
+  ic_collapse_push(ic, ic_whnf(ic, term));
+
+  while (1) {
+    Val top = ic->stack_pos;
+    term = stack[top - 2];
+    Val idx = TERM_VAL(stack[top - 1]);
+
+    // Lift a duplication before walking its value, which its copies walk
+    if (idx == 0) {
+      Term res = ic_collapse_dups_rule(ic, term);
+      if (res != NONE) {
+        ic->stack_pos -= 2;
+        ic_collapse_push(ic, ic_whnf(ic, res));
+        continue;
+      }
+    }
+
+    // Collapse the next field
+    if (idx < ic_collapse_dups_arity(term)) {
+      stack[top - 1] = ic_make_num(idx + 1);
+      ic_collapse_push(ic, ic_whnf(ic, ic->heap[TERM_VAL(term) + idx]));
+      continue;
+    }
+
+    // All fields collapsed: lift the duplication over its collapsed value
+    ic->stack_pos -= 2;
+    Term res = ic_collapse_dups_rule(ic, term);
+    if (res != NONE) {
+      ic_collapse_push(ic, ic_whnf(ic, res));
+      continue;
+    }
+
+    // Done: return it to the parent
+    if (ic->stack_pos == base) {
       return term;
     }
-  } else if (tag == LAM) {
-    ic->heap[loc+0] = ic_collapse_dups(ic, ic->heap[loc+0]);
-    return term;
-  } else if (tag == APP) {
-    ic->heap[loc+0] = ic_collapse_dups(ic, ic->heap[loc+0]);
-    ic->heap[loc+1] = ic_collapse_dups(ic, ic->heap[loc+1]);
-    return term;
-  } else if (IS_SUP(tag)) {
-    ic->heap[loc+0] = ic_collapse_dups(ic, ic->heap[loc+0]);
-    ic->heap[loc+1] = ic_collapse_dups(ic, ic->heap[loc+1]);
-    return term;
-  } else if (tag == SUC) {
-    ic->heap[loc] = ic_collapse_dups(ic, ic->heap[loc]);
-    return term;
-  } else if (tag == SWI) {
-    ic->heap[loc+0] = ic_collapse_dups(ic, ic->heap[loc+0]);
-    ic->heap[loc+1] = ic_collapse_dups(ic, ic->heap[loc+1]);
-    ic->heap[loc+2] = ic_collapse_dups(ic, ic->heap[loc+2]);
-    return term;
-  } else if (ic_is_era(term) || tag == NUM) {
-    // ERA and NUM have no children, so just return them
-    return term;
-  } else {
-    return term;
+    Val parent_idx = TERM_VAL(stack[ic->stack_pos - 1]) - 1;
+    ic->heap[TERM_VAL(stack[ic->stack_pos - 2]) + parent_idx] = term;
+  }
+}
+
+Term ic_collapse(IC* ic, Term term) {
+  term = ic_collapse_sups(ic, term);
+  term = ic_collapse_dups(ic, term);
+  return term;
+}
+
+// Branches collapsed by the threads of ic_collapse_par.
+typedef struct {
+  Val* locs;      // Heap locations holding the branches
+  uint64_t* done; // Shared marks of finished nodes
+} CollapseTasks;
+
+// Split the SUPs at the top of the term stored at root into branches, until
+// there are at least want of them or no SUP is left at the top. A lazy split
+// collapses each branch just until a SUP reaches its top; otherwise the term
+// must already be collapsed.
+// @param locs Where to store the allocated array of branch locations
+// @return The number of branches
+static Val ic_collapse_split(IC* ic, Val root, Val want, uint64_t* done, bool lazy, Val** locs) {
+  // Locations in [head, tail) can still be split; those before head can't
+  Val cap = 2 * want + 2;
+  Val head = 0;
+  Val tail = 0;
+  Val* queue = (Val*)malloc(cap * sizeof(Val));
+  if (!queue) {
+    fprintf(stderr, "Error: Memory allocation failed during collapse\n");
+    exit(1);
+  }
+  queue[tail++] = root;
+
+  Val kept = 0;
+  while (head < tail && tail - kept < want) {
+    Val loc = queue[head++];
+    Term term = ic->heap[loc];
+    if (lazy) {
+      term = ic_collapse_sups_go(ic, term, done, true);
+      ic->heap[loc] = term;
+    }
+    if (!IS_SUP(TERM_TAG(term))) {
+      queue[kept++] = loc;
+      continue;
+    }
+    if (tail + 2 > cap) {
+      cap *= 2;
+      queue = (Val*)realloc(queue, cap * sizeof(Val));
+      if (!queue) {
+        fprintf(stderr, "Error: Memory allocation failed during collapse\n");
+        exit(1);
+      }
+    }
+    queue[tail++] = TERM_VAL(term) + 0;
+    queue[tail++] = TERM_VAL(term) + 1;
+  }
+
+  // Keep the branches that were not split after the finished ones
+  memmove(queue + kept, queue + head, (tail - head) * sizeof(Val));
+  *locs = queue;
+  return kept + tail - head;
+}
+
+// Lift the SUPs of one branch.
+static void ic_collapse_sups_task(IC* ic, Val i, void* ctx) {
+  CollapseTasks* tasks = (CollapseTasks*)ctx;
+  Val loc = tasks->locs[i];
+  ic->heap[loc] = ic_collapse_sups_go(ic, ic->heap[loc], tasks->done, false);
+}
+
+// Lift the DUPs of one branch.
+static void ic_collapse_dups_task(IC* ic, Val i, void* ctx) {
+  CollapseTasks* tasks = (CollapseTasks*)ctx;
+  Val loc = tasks->locs[i];
+  ic->heap[loc] = ic_collapse_dups(ic, ic->heap[loc]);
+}
+
+Term ic_collapse_par(IC* ic, Term term, int threads) {
+  if (threads <= 1) {
+    return ic_collapse(ic, term);
   }
+
+  CollapseTasks tasks;
+  tasks.done = ic_collapse_marks(ic);
+  bool reuse = ic->reuse;
+  ic->reuse = false;
+
+  // The root is collapsed in place, like the branches
+  Val root = ic_alloc(ic, 1);
+  ic->heap[root] = term;
+  Val want = IC_COLLAPSE_TASKS * threads;
+
+  // Split the SUPs that reach the top, and lift the SUPs of each branch
+  Val count = ic_collapse_split(ic, root, want, tasks.done, true, &tasks.locs);
+  ic_parallel_for(ic, threads, count, ic_collapse_sups_task, &tasks);
+  free(tasks.locs);
+
+  // Then the DUPs, once no SUP is left to lift
+  count = ic_collapse_split(ic, root, want, tasks.done, false, &tasks.locs);
+  ic_parallel_for(ic, threads, count, ic_collapse_dups_task, &tasks);
+  free(tasks.locs);
+
+  ic->reuse = reuse;
+  free(tasks.done);
+  return ic->heap[root];
+}
+
+Val ic_collapse_enum(IC* ic, Term term, ICEnumOrder order, Val limit, ICEnumFn emit, void* ctx) {
+  uint64_t* done = ic_collapse_marks(ic);
+  bool reuse = ic->reuse;
+  ic->reuse = false;
+
+  // Branches still to explore: DFS takes the last one, BFS the first one
+  Val cap = 64;
+  Val head = 0;
+  Val tail = 0;
+  Term* pending = (Term*)malloc(cap * sizeof(Term));
+  if (!pending) {
+    fprintf(stderr, "Error: Memory allocation failed during collapse\n");
+    exit(1);
+  }
+  pending[tail++] = term;
+
+  Val count = 0;
+  while (head < tail && (limit == 0 || count < limit)) {
+    term = order == IC_ENUM_BFS ? pending[head++] : pending[--tail];
+    term = ic_collapse_sups_go(ic, term, done, true);
+
+    if (IS_SUP(TERM_TAG(term))) {
+      // Make room for both branches, dropping the entries BFS already took
+      if (tail + 2 > cap) {
+        memmove(pending, pending + head, (tail - head) * sizeof(Term));
+        tail -= head;
+        head = 0;
+        if (tail + 2 > cap) {
+          cap *= 2;
+          pending = (Term*)realloc(pending, cap * sizeof(Term));
+          if (!pending) {
+            fprintf(stderr, "Error: Memory allocation failed during collapse\n");
+            exit(1);
+          }
+        }
+      }
+      Val loc = TERM_VAL(term);
+      if (order == IC_ENUM_BFS) {
+        pending[tail++] = ic->heap[loc + 0];
+        pending[tail++] = ic->heap[loc + 1];
+      } else {
+        pending[tail++] = ic->heap[loc + 1];
+        pending[tail++] = ic->heap[loc + 0];
+      }
+    } else if (!ic_is_era(term)) {
+      count++;
+      if (!emit(ic, ic_collapse_dups(ic, term), ctx)) {
+        break;
+      }
+    }
+  }
+
+  free(pending);
+  ic->reuse = reuse;
+  free(done);
+  return count;
 }
@@ -21,4 +21,43 @@ static inline Term ic_sup_swi_s(IC* ic, Term swi, Term sup);
 Term ic_collapse_sups(IC* ic, Term term);
 Term ic_collapse_dups(IC* ic, Term term);
 
+// Collapse a term: lift its SUPs to the top, then its remaining DUPs.
+Term ic_collapse(IC* ic, Term term);
+
+// Branches that ic_collapse_par splits off for each thread
+#define IC_COLLAPSE_TASKS 4
+
+// Collapse a term using several threads. The SUPs that reach the top are
+// split until each thread has IC_COLLAPSE_TASKS branches, which are then
+// collapsed in parallel and stay under their SUP. Unlike ic_collapse, the
+// labels of these top SUPs are not sorted against those of the branches.
+// @param ic The IC context
+// @param term The term to collapse
+// @param threads Number of threads (1 uses ic_collapse)
+// @return The collapsed term
+Term ic_collapse_par(IC* ic, Term term, int threads);
+
+// Order in which ic_collapse_enum explores the branches of SUPs.
+typedef enum {
+  IC_ENUM_DFS, // Left branch first, to the bottom
+  IC_ENUM_BFS, // Shallower branches first
+} ICEnumOrder;
+
+// Receives each result of ic_collapse_enum.
+// @return False to stop the enumeration
+typedef bool (*ICEnumFn)(IC* ic, Term term, void* ctx);
+
+// Enumerate the results of a term, the SUP-free leaves of its collapse, one
+// at a time. Each branch is collapsed only when it is explored: until a SUP
+// reaches its top, which is then split, or until it is a result, which gets
+// its DUPs collapsed and is passed to emit. Erased branches give no result.
+// @param ic The IC context
+// @param term The term to enumerate
+// @param order The order in which branches are explored
+// @param limit Most results to emit (0 for all)
+// @param emit The function called with each result
+// @param ctx Passed on to emit
+// @return The number of results emitted
+Val ic_collapse_enum(IC* ic, Term term, ICEnumOrder order, Val limit, ICEnumFn emit, void* ctx);
+
 #endif // IC_COLLAPSE_H
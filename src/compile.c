@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compile.h"
+#include "parse.h"
+
+// -----------------------------------------------------------------------------
+// Compiling Definitions to C
+// -----------------------------------------------------------------------------
+
+// Layout of a compiled definition. Its template is copied without the slot
+// holding the definition's root and without the nodes of its leading
+// lambdas, whose variables become arguments.
+typedef struct {
+  Val params[IC_FUN_MAX_ARITY]; // Template locations of the leading lambdas
+  Val arity;                    // Number of leading lambdas
+  Term body;                    // Body of the innermost leading lambda
+  Val* map;                     // New offset of each template location (NONE if dropped)
+  Val size;                     // Number of terms allocated
+} Compiled;
+
+// Read a whole file into a null-terminated buffer.
+static char* read_file(const char* filename) {
+  FILE* file = fopen(filename, "rb");
+  if (!file) {
+    fprintf(stderr, "Error: Could not open file '%s'\n", filename);
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char* buffer = (char*)malloc(size + 1);
+  if (!buffer) {
+    fprintf(stderr, "Error: Memory allocation failed\n");
+    fclose(file);
+    return NULL;
+  }
+  size_t read_size = fread(buffer, 1, size, file);
+  fclose(file);
+  buffer[read_size] = '\0';
+  return buffer;
+}
+
+// Write a string as a C literal, one source line per line. Bytes outside of
+// printable ASCII (such as the UTF-8 of λ) are written as octal escapes.
+static void emit_string(FILE* out, const char* str) {
+  fprintf(out, "  \"");
+  for (const unsigned char* c = (const unsigned char*)str; *c; c++) {
+    if (*c == '\n') {
+      fprintf(out, "\\n\"\n  \"");
+    } else if (*c == '"' || *c == '\\') {
+      fprintf(out, "\\%c", *c);
+    } else if (*c < 0x20 || *c >= 0x7F) {
+      fprintf(out, "\\%03o", *c);
+    } else {
+      fputc(*c, out);
+    }
+  }
+  fprintf(out, "\"");
+}
+
+// Find the leading lambdas of a definition and lay out the rest of it.
+// @return False if the definition does not start with a lambda
+static bool compile_layout(ICDef* def, Compiled* cmp) {
+  cmp->arity = 0;
+  Term term = def->root;
+  while (TERM_TAG(term) == LAM && cmp->arity < IC_FUN_MAX_ARITY) {
+    cmp->params[cmp->arity++] = TERM_VAL(term);
+    term = def->terms[TERM_VAL(term)];
+  }
+  if (cmp->arity == 0) {
+    return false;
+  }
+  cmp->body = term;
+
+  // The parser puts the root at the start of the template
+  cmp->map = (Val*)malloc((def->size + 1) * sizeof(Val));
+  for (Val i = 0; i < def->size; i++) {
+    cmp->map[i] = 0;
+  }
+  cmp->map[0] = NONE;
+  for (Val i = 0; i < cmp->arity; i++) {
+    cmp->map[cmp->params[i]] = NONE;
+  }
+  cmp->size = 0;
+  for (Val i = 0; i < def->size; i++) {
+    if (cmp->map[i] != NONE) {
+      cmp->map[i] = cmp->size++;
+    }
+  }
+  return true;
+}
+
+// Write the C expression that builds a template term: an argument for the
+// variable of a leading lambda, a location relative to the allocation for
+// other pointers, or a constant.
+static void emit_term(FILE* out, Compiled* cmp, Term term) {
+  if (TERM_TAG(term) == VAR) {
+    for (Val i = 0; i < cmp->arity; i++) {
+      if (TERM_VAL(term) == cmp->params[i]) {
+        fprintf(out, "args[%llu]", (unsigned long long)i);
+        return;
+      }
+    }
+  }
+  if (ic_has_loc(term)) {
+    Term moved = (term & ~TERM_VAL_MASK) | cmp->map[TERM_VAL(term)];
+    fprintf(out, "0x%016llxULL + loc", (unsigned long long)moved);
+  } else {
+    fprintf(out, "0x%016llxULL", (unsigned long long)term);
+  }
+}
+
+// Write the C function of a definition.
+static void emit_def(FILE* out, ICDef* def, Val id, Compiled* cmp) {
+  fprintf(out, "// @%s\n", def->name);
+  fprintf(out, "static Term ic_fn_%llu(IC* ic, Term* args) {\n", (unsigned long long)id);
+  if (cmp->size > 0) {
+    fprintf(out, "  Val loc = ic_alloc(ic, %llu);\n", (unsigned long long)cmp->size);
+    fprintf(out, "  Term* heap = ic->heap + loc;\n");
+    for (Val i = 0; i < def->size; i++) {
+      if (cmp->map[i] != NONE) {
+        fprintf(out, "  heap[%llu] = ", (unsigned long long)cmp->map[i]);
+        emit_term(out, cmp, def->terms[i]);
+        fprintf(out, ";\n");
+      }
+    }
+  } else {
+    fprintf(out, "  (void)ic;\n");
+  }
+  fprintf(out, "  return ");
+  emit_term(out, cmp, cmp->body);
+  fprintf(out, ";\n");
+  fprintf(out, "}\n\n");
+}
+
+// Write the startup code: parse the embedded source, attach the compiled
+// definitions, then normalize and print like `ic run`.
+static void emit_main(FILE* out, IC* ic, Val* arities) {
+  fprintf(out, "// Attach the compiled definitions to a parsed book\n");
+  fprintf(out, "void ic_compiled_register(IC* ic) {\n");
+  fprintf(out, "  (void)ic;\n");
+  for (Val i = 0; i < ic->def_count; i++) {
+    if (arities[i] > 0) {
+      fprintf(out, "  ic_def_native(ic, \"%s\", %llu, ic_fn_%llu);\n", ic->defs[i].name,
+              (unsigned long long)arities[i], (unsigned long long)i);
+    }
+  }
+  fprintf(out, "}\n\n");
+  fprintf(out,
+    "int main(void) {\n"
+    "  IC* ic = ic_default_new();\n"
+    "  if (!ic) {\n"
+    "    fprintf(stderr, \"Error: Failed to initialize IC context\\n\");\n"
+    "    return 1;\n"
+    "  }\n"
+    "  Term term = parse_string(ic, ic_source);\n"
+    "  if (term == NONE) {\n"
+    "    ic_free(ic);\n"
+    "    return 1;\n"
+    "  }\n"
+    "  ic_compiled_register(ic);\n"
+    "\n"
+    "  struct timeval start_time, current_time;\n"
+    "  gettimeofday(&start_time, NULL);\n"
+    "  term = ic_normal(ic, term);\n"
+    "  gettimeofday(&current_time, NULL);\n"
+    "  double elapsed_seconds = (current_time.tv_sec - start_time.tv_sec) +\n"
+    "                           (current_time.tv_usec - start_time.tv_usec) / 1000000.0;\n"
+    "  double perf = elapsed_seconds > 0 ? (ic->interactions / elapsed_seconds) / 1000000.0 : 0.0;\n"
+    "\n"
+    "  show_term_namespaced(stdout, ic, term, \"$\");\n"
+    "  printf(\"\\n\\n\");\n"
+    "  printf(\"WORK: %%llu interactions\\n\", (unsigned long long)ic->interactions);\n"
+    "  printf(\"TIME: %%.7f seconds\\n\", elapsed_seconds);\n"
+    "  printf(\"SIZE: %%zu nodes\\n\", (size_t)ic_heap_used(ic));\n"
+    "  printf(\"PERF: %%.3f MIPS\\n\", perf);\n"
+    "  printf(\"MODE: CPU (compiled)\\n\\n\");\n"
+    "\n"
+    "  ic_free(ic);\n"
+    "  return 0;\n"
+    "}\n");
+}
+
+// Compile the definitions of an IC file to a C translation unit.
+// @param out The output stream
+// @param ic The IC context used for parsing
+// @param filename The IC file
+// @return 0 on success, -1 on failure
+int compile_file(FILE* out, IC* ic, const char* filename) {
+  if (!IC_HAS_REF) {
+    fprintf(stderr, "Error: Compiling definitions needs the 64-bit build\n");
+    return -1;
+  }
+  char* source = read_file(filename);
+  if (!source) {
+    return -1;
+  }
+  if (parse_string(ic, source) == NONE) {
+    free(source);
+    return -1;
+  }
+
+  fprintf(out, "// Generated by `ic compile %s`. Build it with the 64-bit runtime:\n", filename);
+  fprintf(out, "//   gcc -O3 -std=c99 -pthread -DIC_64BIT -Isrc out.c src/ic.c src/parse.c src/show.c src/collapse.c src/parallel.c\n\n");
+  fprintf(out, "#define _DEFAULT_SOURCE\n");
+  fprintf(out, "#include <stdio.h>\n");
+  fprintf(out, "#include <sys/time.h>\n");
+  fprintf(out, "#include \"ic.h\"\n");
+  fprintf(out, "#include \"parse.h\"\n");
+  fprintf(out, "#include \"show.h\"\n\n");
+  fprintf(out, "#ifndef IC_64BIT\n");
+  fprintf(out, "#error \"Compiled IC programs need the 64-bit runtime (-DIC_64BIT)\"\n");
+  fprintf(out, "#endif\n\n");
+  fprintf(out, "static const char* ic_source =\n");
+  emit_string(out, source);
+  fprintf(out, ";\n\n");
+
+  // Number of arguments of each compiled definition (0 if not compiled)
+  Val* arities = (Val*)calloc(ic->def_count + 1, sizeof(Val));
+  for (Val i = 0; i < ic->def_count; i++) {
+    Compiled cmp;
+    if (compile_layout(&ic->defs[i], &cmp)) {
+      emit_def(out, &ic->defs[i], i, &cmp);
+      arities[i] = cmp.arity;
+      free(cmp.map);
+    }
+  }
+  emit_main(out, ic, arities);
+
+  free(arities);
+  free(source);
+  return 0;
+}
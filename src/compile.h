@@ -0,0 +1,23 @@
+//./compile.c//
+
+#ifndef IC_COMPILE_H
+#define IC_COMPILE_H
+
+#include <stdio.h>
+#include "ic.h"
+
+// Compile the definitions of an IC file to a C translation unit.
+// Every definition whose body starts with lambdas becomes a C function that
+// builds the body of those lambdas in one allocation, with the arguments
+// written where their variables were. The output embeds the source, parses
+// it at startup, attaches the functions with ic_def_native and normalizes
+// the main term; references that are not fully applied, or that meet a
+// duplication, still go through the interpreter. It links against ic.c,
+// parse.c, show.c, collapse.c and parallel.c of the 64-bit build.
+// @param out The output stream
+// @param ic The IC context used for parsing
+// @param filename The IC file
+// @return 0 on success, -1 on failure
+int compile_file(FILE* out, IC* ic, const char* filename);
+
+#endif // IC_COMPILE_H
@@ -1,14 +1,243 @@
+#define _DEFAULT_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "ic.h"
 
 // -----------------------------------------------------------------------------
 // Memory Management Functions
 // -----------------------------------------------------------------------------
 
+// Contexts whose guard pages are watched by the fault handler, in chunks
+// of IC_GUARD_CHUNK slots. Chunks are added under ic_guarded_lock and never
+// freed, so the handler can walk them at any time.
+#define IC_GUARD_CHUNK 64
+typedef struct ICGuardChunk {
+  IC* volatile slots[IC_GUARD_CHUNK];
+  struct ICGuardChunk* volatile next;
+} ICGuardChunk;
+static ICGuardChunk ic_guarded;
+static pthread_mutex_t ic_guarded_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void ic_alloc_release(IC* ic);
+static void ic_rules_init(void);
+
+// Get the alignment used for mappings with the given page backing.
+// @param pages The requested page backing
+// @return Alignment in bytes
+static size_t ic_page_align(ICPages pages) {
+  switch (pages) {
+    case IC_PAGES_THP:
+    case IC_PAGES_2M: return 1UL << 21;
+    case IC_PAGES_1G: return 1UL << 30;
+    default:          return (size_t)sysconf(_SC_PAGE_SIZE);
+  }
+}
+
+// Get the size of the mapping that holds n terms plus its guard region.
+// @param n Number of terms
+// @param pages The requested page backing
+// @return Size of the mapping in bytes
+static size_t ic_mapping_size(Val n, ICPages pages) {
+  size_t align = ic_page_align(pages);
+  size_t bytes = ((size_t)n * sizeof(Term) + align - 1) / align * align;
+  return bytes + IC_GUARD_SIZE;
+}
+
+// Reserve address space for n terms, followed by an inaccessible guard
+// region. Pages are only committed (and zeroed) by the kernel when they are
+// first touched, so a large, mostly unused heap costs nothing up front.
+// With huge pages, the terms are remapped with MAP_HUGETLB, falling back to
+// transparent huge pages when no huge pages of that size are available.
+// @param n Number of terms to reserve
+// @param pages The requested page backing
+// @param got Where to store the backing actually obtained
+// @return The reserved memory or NULL if the reservation failed
+static Term* ic_reserve(Val n, ICPages pages, ICPages* got) {
+  size_t size = ic_mapping_size(n, pages);
+  size_t align = ic_page_align(pages);
+  size_t bytes = size - IC_GUARD_SIZE;
+  *got = IC_PAGES_SMALL;
+
+  // Reserve with room to align the start to the page size
+  size_t span = size + (pages == IC_PAGES_SMALL ? 0 : align);
+  char* base = mmap(NULL, span, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED) return NULL;
+  char* mem = (char*)(((uintptr_t)base + align - 1) / align * align);
+  if (mem > base) munmap(base, mem - base);
+  if (base + span > mem + size) munmap(mem + size, base + span - (mem + size));
+
+  // Commit the terms; the guard stays PROT_NONE
+  #ifdef MAP_HUGETLB
+  if (pages == IC_PAGES_2M || pages == IC_PAGES_1G) {
+    int shift = pages == IC_PAGES_2M ? 21 : 30;
+    void* huge = mmap(mem, bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+    if (huge != MAP_FAILED) {
+      *got = pages;
+      return (Term*)mem;
+    }
+  }
+  #endif
+  void* small = mmap(mem, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+  if (small == MAP_FAILED) {
+    munmap(mem, size);
+    return NULL;
+  }
+  #ifdef MADV_HUGEPAGE
+  if (pages != IC_PAGES_SMALL && madvise(mem, bytes, MADV_HUGEPAGE) == 0) {
+    *got = IC_PAGES_THP;
+  }
+  #endif
+  return (Term*)mem;
+}
+
+// Check whether an address falls in the guard region after n terms at mem.
+static inline bool ic_in_guard(Term* mem, Val n, ICPages pages, char* addr) {
+  char* guard = (char*)mem + ic_mapping_size(n, pages) - IC_GUARD_SIZE;
+  return mem && addr >= guard && addr < guard + IC_GUARD_SIZE;
+}
+
+// Write an error message with the interaction count and exit. Only uses
+// async-signal-safe calls, since it runs inside the fault handler.
+static void ic_guard_exit(const char* msg, uint64_t interactions) {
+  char buf[128];
+  size_t len = 0;
+  while (*msg) buf[len++] = *msg++;
+  char digits[24];
+  int n = 0;
+  do {
+    digits[n++] = '0' + interactions % 10;
+    interactions /= 10;
+  } while (interactions > 0);
+  while (n > 0) buf[len++] = digits[--n];
+  const char* tail = " interactions\n";
+  while (*tail) buf[len++] = *tail++;
+  write(STDERR_FILENO, buf, len);
+  _exit(1);
+}
+
+// Fault handler: turns a write into a heap or stack guard region into a
+// clean error. Any other fault is re-raised with the default action.
+// It also tracks the first write to each page of a heap snapshot: the page
+// is recorded as dirty and made writable, and the write is retried.
+static void ic_guard_handler(int sig, siginfo_t* info, void* uctx) {
+  (void)uctx;
+  char* addr = (char*)info->si_addr;
+  for (ICGuardChunk* chunk = &ic_guarded; chunk; chunk = chunk->next) {
+    for (int i = 0; i < IC_GUARD_CHUNK; i++) {
+      IC* ic = chunk->slots[i];
+      if (!ic) continue;
+      if (ic->snap && addr >= (char*)ic->heap && addr < (char*)ic->heap + ic->snap_pages * ic->snap_page_size) {
+        size_t page = (addr - (char*)ic->heap) / ic->snap_page_size;
+        if (!__atomic_exchange_n(&ic->snap_dirty[page], 1, __ATOMIC_RELAXED)) {
+          ic->snap_dirty_list[__atomic_fetch_add(&ic->snap_dirty_len, 1, __ATOMIC_RELAXED)] = page;
+        }
+        mprotect((char*)ic->heap + page * ic->snap_page_size, ic->snap_page_size, PROT_READ | PROT_WRITE);
+        return;
+      }
+      if (ic_in_guard(ic->heap, ic->heap_size, ic->pages, addr)) {
+        ic_guard_exit("Error: Heap exhausted at ", ic->interactions);
+      }
+      if (ic_in_guard(ic->stack, ic->stack_size, ic->pages, addr)) {
+        ic_guard_exit("Error: Stack overflow at ", ic->interactions);
+      }
+    }
+  }
+  signal(sig, SIG_DFL);
+}
+
+// Give the calling thread its own signal stack, unless it has one.
+void* ic_guard_thread_start(void) {
+  stack_t alt;
+  if (sigaltstack(NULL, &alt) == 0 && !(alt.ss_flags & SS_DISABLE)) {
+    return NULL;
+  }
+  alt.ss_sp = malloc(SIGSTKSZ);
+  alt.ss_size = SIGSTKSZ;
+  alt.ss_flags = 0;
+  if (alt.ss_sp && sigaltstack(&alt, NULL) != 0) {
+    free(alt.ss_sp);
+    return NULL;
+  }
+  return alt.ss_sp;
+}
+
+// Remove the signal stack given by ic_guard_thread_start.
+void ic_guard_thread_stop(void* alt) {
+  if (!alt) {
+    return;
+  }
+  stack_t off;
+  off.ss_sp = NULL;
+  off.ss_size = 0;
+  off.ss_flags = SS_DISABLE;
+  sigaltstack(&off, NULL);
+  free(alt);
+}
+
+// Install the fault handler (once) and start watching a context's guards.
+// The handler runs on its own signal stack, so it still works when the
+// fault comes from a deep recursion. Other threads get theirs from
+// ic_guard_thread_start.
+static void ic_guard_watch(IC* ic) {
+  static bool installed = false;
+  pthread_mutex_lock(&ic_guarded_lock);
+  if (!installed) {
+    ic_guard_thread_start();
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = ic_guard_handler;
+    sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, NULL);
+    sigaction(SIGBUS, &sa, NULL);
+    installed = true;
+  }
+  for (ICGuardChunk* chunk = &ic_guarded; chunk; chunk = chunk->next) {
+    for (int i = 0; i < IC_GUARD_CHUNK; i++) {
+      if (!chunk->slots[i]) {
+        chunk->slots[i] = ic;
+        pthread_mutex_unlock(&ic_guarded_lock);
+        return;
+      }
+    }
+    if (!chunk->next) {
+      ICGuardChunk* next = (ICGuardChunk*)calloc(1, sizeof(ICGuardChunk));
+      if (!next) {
+        fprintf(stderr, "Warning: Heap and stack overflows of a context will not be reported\n");
+        break;
+      }
+      __atomic_store_n(&chunk->next, next, __ATOMIC_RELEASE);
+    }
+  }
+  pthread_mutex_unlock(&ic_guarded_lock);
+}
+
+// Stop watching a context's guards.
+static void ic_guard_unwatch(IC* ic) {
+  pthread_mutex_lock(&ic_guarded_lock);
+  for (ICGuardChunk* chunk = &ic_guarded; chunk; chunk = chunk->next) {
+    for (int i = 0; i < IC_GUARD_CHUNK; i++) {
+      if (chunk->slots[i] == ic) {
+        chunk->slots[i] = NULL;
+      }
+    }
+  }
+  pthread_mutex_unlock(&ic_guarded_lock);
+}
+
 // Create a new IC context with the specified heap and stack sizes.
 // @param heap_size Number of terms in the heap
 // @param stack_size Number of terms in the stack
+// @param pages The page backing to request for the heap and stack
 // @return A new IC context or NULL if allocation failed
-inline IC* ic_new(Val heap_size, Val stack_size) {
+IC* ic_new(Val heap_size, Val stack_size, ICPages pages) {
   IC* ic = (IC*)malloc(sizeof(IC));
   if (!ic) return NULL;
 
@@ -16,49 +245,559 @@ inline IC* ic_new(Val heap_size, Val stack_size) {
   ic->heap_size = heap_size;
   ic->stack_size = stack_size;
   ic->heap_pos = 0;
+  ic->heap_end = NONE;
+  ic->heap_waste = 0;
   ic->interactions = 0;
   ic->stack_pos = 0;
-
-  // Allocate heap and stack
-  ic->heap = (Term*)calloc(heap_size, sizeof(Term));
-  ic->stack = (Term*)malloc(stack_size * sizeof(Term));
+  ic->reuse = false;
+  for (Val i = 0; i < 4; i++) {
+    ic->free_list[i] = NONE;
+  }
+  ic->gc_limit = NONE;
+  ic->gc_space = NULL;
+  ic->gc_space_bytes = 0;
+  ic->pages = pages;
+  ic->snap = NULL;
+  ic->ctrs = NULL;
+  ic->ctr_count = 0;
+  ic->defs = NULL;
+  ic->def_count = 0;
+  ic->def_cap = 0;
+  ic->def_index = NULL;
+  ic->def_index_size = 0;
+  ic->parent = NULL;
+  ic->fuel_end = 0;
+  ic->susp_next = NONE;
+  ic->susp_stop = 0;
+  ic->susp_base = NONE;
+  ic_rules_init();
+
+  // Reserve heap and stack
+  ic->heap = ic_reserve(heap_size, pages, &ic->heap_pages);
+  ic->stack = ic_reserve(stack_size, pages, &ic->stack_pages);
 
   if (!ic->heap || !ic->stack) {
     ic_free(ic);
     return NULL;
   }
 
+  ic_guard_watch(ic);
+
   return ic;
 }
 
 // Create a new IC context with default heap and stack sizes.
 // @return A new IC context or NULL if allocation failed
 inline IC* ic_default_new() {
-  return ic_new(IC_DEFAULT_HEAP_SIZE, IC_DEFAULT_STACK_SIZE);
+  return ic_new(IC_DEFAULT_HEAP_SIZE, IC_DEFAULT_STACK_SIZE, IC_PAGES_SMALL);
+}
+
+// Create a worker context that shares the heap of ic.
+// @param ic The IC context whose heap is shared
+// @return A new worker context or NULL if allocation failed
+IC* ic_worker_new(IC* ic) {
+  IC* worker = (IC*)malloc(sizeof(IC));
+  if (!worker) return NULL;
+
+  *worker = *ic;
+  worker->heap_pos = 0;
+  worker->heap_end = 0; // The first allocation takes a chunk
+  worker->heap_waste = 0;
+  worker->interactions = 0;
+  worker->stack_pos = 0;
+  for (Val i = 0; i < 4; i++) {
+    worker->free_list[i] = NONE;
+  }
+  worker->gc_limit = NONE;
+  worker->gc_space = NULL; // Workers never collect
+  worker->snap = NULL;
+  worker->parent = ic;
+  worker->susp_next = NONE;
+  worker->susp_base = NONE;
+
+  worker->stack = ic_reserve(ic->stack_size, ic->pages, &worker->stack_pages);
+  if (!worker->stack) {
+    free(worker);
+    return NULL;
+  }
+
+  ic_guard_watch(worker);
+
+  return worker;
 }
 
 // Free all resources associated with an IC context.
 // @param ic The IC context to free
-inline void ic_free(IC* ic) {
+void ic_free(IC* ic) {
   if (!ic) return;
 
-  if (ic->heap) free(ic->heap);
-  if (ic->stack) free(ic->stack);
+  if (ic->parent) {
+    ic_alloc_release(ic);
+  }
+  ic_snapshot_free(ic);
+  ic_guard_unwatch(ic);
+  if (ic->heap && !ic->parent) munmap(ic->heap, ic_mapping_size(ic->heap_size, ic->pages));
+  if (ic->stack) munmap(ic->stack, ic_mapping_size(ic->stack_size, ic->pages));
+  if (ic->gc_space) munmap(ic->gc_space, ic->gc_space_bytes);
+  if (!ic->parent) {
+    for (Val i = 0; i < ic->ctr_count; i++) {
+      free(ic->ctrs[i].name);
+    }
+    free(ic->ctrs);
+    for (Val i = 0; i < ic->def_count; i++) {
+      free(ic->defs[i].name);
+      free(ic->defs[i].terms);
+    }
+    free(ic->defs);
+    free(ic->def_index);
+  }
 
   free(ic);
 }
 
+// Declare a data type, giving its constructors consecutive ids.
+// @param ic The IC context
+// @param names Constructor names, without the leading '#'
+// @param arities Number of fields of each constructor
+// @param count Number of constructors
+// @return The id of the first constructor, or NONE if there are too many
+Val ic_ctr_declare(IC* ic, const char** names, const Val* arities, Val count) {
+  Val first = ic->ctr_count;
+  if (first + count > IC_CTR_MAX) {
+    return NONE;
+  }
+  ICCtr* ctrs = (ICCtr*)realloc(ic->ctrs, (first + count) * sizeof(ICCtr));
+  if (!ctrs) {
+    return NONE;
+  }
+  ic->ctrs = ctrs;
+  for (Val i = 0; i < count; i++) {
+    ICCtr* ctr = &ic->ctrs[first + i];
+    ctr->name = strdup(names[i]);
+    ctr->arity = arities[i];
+    ctr->first = first;
+    ctr->count = count;
+  }
+  ic->ctr_count = first + count;
+  return first;
+}
+
+// Hash a definition name (FNV-1a).
+static uint64_t ic_def_hash(const char* name) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const char* c = name; *c; c++) {
+    hash = (hash ^ (uint8_t)*c) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// Find the slot of a name in the definition index.
+// @return The slot holding its id, or the empty slot where it would go
+static Val ic_def_slot(IC* ic, const char* name) {
+  Val mask = ic->def_index_size - 1;
+  Val slot = ic_def_hash(name) & mask;
+  while (ic->def_index[slot] != NONE && strcmp(ic->defs[ic->def_index[slot]].name, name) != 0) {
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+// Double the definition index, keeping it at most half full.
+// @return False if it could not be allocated
+static bool ic_def_grow_index(IC* ic) {
+  Val size = ic->def_index_size ? ic->def_index_size * 2 : 64;
+  Val* index = (Val*)malloc(size * sizeof(Val));
+  if (!index) {
+    return false;
+  }
+  for (Val i = 0; i < size; i++) {
+    index[i] = NONE;
+  }
+  free(ic->def_index);
+  ic->def_index = index;
+  ic->def_index_size = size;
+  for (Val i = 0; i < ic->def_count; i++) {
+    ic->def_index[ic_def_slot(ic, ic->defs[i].name)] = i;
+  }
+  return true;
+}
+
+// Find a top-level definition by name, adding an undefined one if missing.
+// @param ic The IC context
+// @param name The definition name, without the leading '@'
+// @return Its id, or NONE if it could not be added
+Val ic_def_declare(IC* ic, const char* name) {
+  if ((ic->def_count + 1) * 2 > ic->def_index_size && !ic_def_grow_index(ic)) {
+    return NONE;
+  }
+  Val slot = ic_def_slot(ic, name);
+  if (ic->def_index[slot] != NONE) {
+    return ic->def_index[slot];
+  }
+  if (ic->def_count == ic->def_cap) {
+    Val cap = ic->def_cap ? ic->def_cap * 2 : 16;
+    ICDef* defs = (ICDef*)realloc(ic->defs, cap * sizeof(ICDef));
+    if (!defs) {
+      return NONE;
+    }
+    ic->defs = defs;
+    ic->def_cap = cap;
+  }
+  ICDef* def = &ic->defs[ic->def_count];
+  def->name = strdup(name);
+  def->terms = NULL;
+  def->size = 0;
+  def->root = ic_make_era();
+  def->fun = NULL;
+  def->arity = 0;
+  ic->def_index[slot] = ic->def_count;
+  return ic->def_count++;
+}
+
+// A duplication node whose variable was erased before the other one read its
+// half holds an erasure pointing to the cell its value was moved to (see
+// ic_erase). Real erasures have a zero value, and IC_LOCK and IC_ERASED use
+// the two largest ones.
+#define IC_DUP_MOVED(loc) MAKE_TERM(false, ERA, 0, loc)
+#define IS_DUP_MOVED(term) (TERM_TAG(term) == ERA && TERM_VAL(term) != 0 && TERM_VAL(term) < TERM_VAL_MASK - 1)
+
+// Number of terms in the node a term points to (0 if it points to none).
+// A closed lambda counts its whole block, so the collector moves it in one piece.
+static inline Val ic_node_size(Term term) {
+  TermTag tag = TERM_TAG(term);
+  if (IS_DUP_MOVED(term)) {
+    return 1;
+  } else if (tag == LAM && LAM_SIZE(term) > 0) {
+    return LAM_SIZE(term);
+  } else if (tag == VAR || tag == LAM || tag == SUC || IS_DUP(tag)) {
+    return 1;
+  } else if (tag == APP || IS_SUP(tag)) {
+    return 2;
+  } else if (tag == SWI || tag == OP2) {
+    return 3;
+  } else if (IS_CTR(tag)) {
+    return CTR_ARI(term);
+  } else if (IS_MAT(tag)) {
+    return MAT_LEN(term) + 2;
+  } else {
+    return 0;
+  }
+}
+
+// Check whether a term holds a heap location.
+// @param term The term to check
+// @return True if the term's value is a location to relocate
+inline bool ic_has_loc(Term term) {
+  TermTag tag = TERM_TAG(term);
+  if (tag == ERA) {
+    return IS_DUP_MOVED(term);
+  } else if (tag == NUM || IS_REF(tag)) {
+    return false;
+  } else if (IS_CTR(tag)) {
+    return CTR_ARI(term) > 0;
+  } else {
+    return true;
+  }
+}
+
+// Check a term read from a file.
+// @param ic The IC context
+// @param term The term to check
+// @param limit End of the terms it may point into
+// @return True if the term can be used safely
+bool ic_term_valid(IC* ic, Term term, Val limit) {
+  term = ic_clear_sub(term);
+  TermTag tag = TERM_TAG(term);
+  if (tag >= TERM_TAG_COUNT) {
+    return false;
+  } else if (IS_REF(tag)) {
+    return TERM_VAL(term) < ic->def_count;
+  } else if (IS_CTR(tag) && CTR_CID(term) >= ic->ctr_count) {
+    return false;
+  } else if (!ic_has_loc(term)) {
+    return true;
+  }
+  Val n = ic_node_size(term);
+  return TERM_VAL(term) < limit && (n ? n : 1) <= limit - TERM_VAL(term);
+}
+
+// Set the body of a top-level definition to a heap segment.
+// @param ic The IC context
+// @param id The definition id
+// @param start First location of the segment
+// @param end Location after the segment
+// @param root The body, pointing into the segment
+// @return True on success, false if the template could not be allocated
+bool ic_def_set(IC* ic, Val id, Val start, Val end, Term root) {
+  ICDef* def = &ic->defs[id];
+  Term* terms = (Term*)malloc((end - start) * sizeof(Term) + 1);
+  if (!terms) {
+    return false;
+  }
+  for (Val i = start; i < end; i++) {
+    Term term = ic->heap[i];
+    terms[i - start] = ic_has_loc(term) ? term - start : term;
+  }
+  free(def->terms);
+  def->terms = terms;
+  def->size = end - start;
+  def->root = ic_has_loc(root) ? root - start : root;
+  return true;
+}
+
+// Attach a compiled body to a definition.
+// @param ic The IC context
+// @param name The definition name, without the leading '@'
+// @param arity Number of leading lambdas replaced by fun
+// @param fun The compiled body
+// @return True on success, false if there is no such definition
+bool ic_def_native(IC* ic, const char* name, Val arity, ICFun fun) {
+  if (arity > IC_FUN_MAX_ARITY) {
+    return false;
+  }
+  if (ic->def_count == 0) {
+    return false;
+  }
+  Val id = ic->def_index[ic_def_slot(ic, name)];
+  if (id == NONE) {
+    return false;
+  }
+  ic->defs[id].fun = fun;
+  ic->defs[id].arity = arity;
+  return true;
+}
+
+// Find a declared constructor by name.
+// @param ic The IC context
+// @param name The constructor name, without the leading '#'
+// @return Its id, or NONE if it was not declared
+Val ic_ctr_find(IC* ic, const char* name) {
+  for (Val i = 0; i < ic->ctr_count; i++) {
+    if (strcmp(ic->ctrs[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return NONE;
+}
+
+// Take a snapshot of the heap up to the current allocation position.
+// The snapshotted pages are write-protected; the fault handler records the
+// pages written after that, so ic_restore only copies those back. The last,
+// partially used page is always written by new allocations, so it is not
+// protected but copied back on every restore, as are small snapshots.
+// @param ic The IC context
+// @return True on success, false if the snapshot could not be allocated
+bool ic_snapshot(IC* ic) {
+  ic_snapshot_free(ic);
+
+  size_t page_size = ic->heap_pages == IC_PAGES_2M || ic->heap_pages == IC_PAGES_1G
+    ? ic_page_align(ic->heap_pages)
+    : (size_t)sysconf(_SC_PAGE_SIZE);
+  size_t bytes = (size_t)ic->heap_pos * sizeof(Term);
+  size_t pages = bytes / page_size;
+  if (pages < IC_SNAPSHOT_MIN_PAGES) {
+    pages = 0;
+  }
+
+  Term* snap = (Term*)malloc(bytes > 0 ? bytes : 1);
+  uint8_t* dirty = (uint8_t*)calloc(pages + 1, 1);
+  size_t* dirty_list = (size_t*)malloc((pages + 1) * sizeof(size_t));
+  if (!snap || !dirty || !dirty_list) {
+    free(snap);
+    free(dirty);
+    free(dirty_list);
+    return false;
+  }
+  memcpy(snap, ic->heap, bytes);
+
+  ic->snap_pos = ic->heap_pos;
+  ic->snap_waste = ic->heap_waste;
+  ic->snap_page_size = page_size;
+  ic->snap_pages = pages;
+  ic->snap_dirty = dirty;
+  ic->snap_dirty_list = dirty_list;
+  ic->snap_dirty_len = 0;
+  ic->snap = snap;
+  if (pages > 0) {
+    mprotect(ic->heap, pages * page_size, PROT_READ);
+  }
+  return true;
+}
+
+// Restore the heap to the last snapshot, copying back only the pages that
+// were written since, and reset the allocator and the evaluation stack.
+// @param ic The IC context
+void ic_restore(IC* ic) {
+  if (!ic->snap) return;
+  char* heap = (char*)ic->heap;
+  char* snap = (char*)ic->snap;
+  size_t page_size = ic->snap_page_size;
+  for (size_t i = 0; i < ic->snap_dirty_len; i++) {
+    size_t page = ic->snap_dirty_list[i];
+    memcpy(heap + page * page_size, snap + page * page_size, page_size);
+    mprotect(heap + page * page_size, page_size, PROT_READ);
+    ic->snap_dirty[page] = 0;
+  }
+  ic->snap_dirty_len = 0;
+  size_t tail = ic->snap_pages * page_size;
+  memcpy(heap + tail, snap + tail, (size_t)ic->snap_pos * sizeof(Term) - tail);
+  ic->heap_pos = ic->snap_pos;
+  ic->heap_waste = ic->snap_waste;
+  ic->stack_pos = 0;
+  for (Val i = 0; i < 4; i++) {
+    ic->free_list[i] = NONE;
+  }
+}
+
+// Drop the snapshot, making the whole heap writable again.
+// @param ic The IC context
+void ic_snapshot_free(IC* ic) {
+  if (!ic->snap) return;
+  Term* snap = ic->snap;
+  ic->snap = NULL;
+  mprotect(ic->heap, ic->snap_pages * ic->snap_page_size, PROT_READ | PROT_WRITE);
+  free(snap);
+  free(ic->snap_dirty);
+  free(ic->snap_dirty_list);
+}
+
+// Describe a page backing.
+// @param pages The page backing
+// @return A short human-readable name
+inline const char* ic_pages_name(ICPages pages) {
+  switch (pages) {
+    case IC_PAGES_THP: return "transparent huge pages";
+    case IC_PAGES_2M:  return "2MB huge pages";
+    case IC_PAGES_1G:  return "1GB huge pages";
+    default:           return "regular pages";
+  }
+}
+
+// Read a memory limit in bytes from a cgroup file.
+// @param path The cgroup file to read
+// @return The limit, or 0 if the file is missing or has no limit
+static uint64_t ic_cgroup_limit(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (!file) return 0;
+  unsigned long long limit = 0;
+  if (fscanf(file, "%llu", &limit) != 1) {
+    limit = 0; // "max" means unlimited
+  }
+  fclose(file);
+  return limit;
+}
+
+// Get the memory available to this process: physical memory, further
+// limited by the cgroup (v2 or v1) the process runs in.
+// @return Available memory in bytes
+inline uint64_t ic_available_memory() {
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long page_size = sysconf(_SC_PAGE_SIZE);
+  uint64_t mem = (pages > 0 && page_size > 0) ? (uint64_t)pages * page_size : 0;
+
+  const char* paths[] = {
+    "/sys/fs/cgroup/memory.max",
+    "/sys/fs/cgroup/memory/memory.limit_in_bytes",
+  };
+  for (int i = 0; i < 2; i++) {
+    uint64_t limit = ic_cgroup_limit(paths[i]);
+    if (limit > 0 && (mem == 0 || limit < mem)) {
+      mem = limit;
+    }
+  }
+  return mem;
+}
+
+// Take a new chunk from the parent's heap and allocate n terms from it.
+// If the current chunk is still the last one taken, it is extended in place
+// instead, so that nothing is wasted.
+// @param ic The worker context
+// @param n Number of terms to allocate
+// @return Location in the heap
+static Val ic_alloc_chunk(IC* ic, Val n) {
+  IC* parent = ic->parent;
+  Val size = n > IC_TLAB_SIZE ? n : IC_TLAB_SIZE;
+  Val end = ic->heap_end;
+  if (end != 0 && __atomic_compare_exchange_n(&parent->heap_pos, &end, end + size, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    ic->heap_end += size;
+  } else {
+    if (ic->heap_end != 0) {
+      __atomic_fetch_add(&parent->heap_waste, ic->heap_end - ic->heap_pos, __ATOMIC_RELAXED);
+    }
+    ic->heap_pos = __atomic_fetch_add(&parent->heap_pos, size, __ATOMIC_RELAXED);
+    ic->heap_end = ic->heap_pos + size;
+  }
+  Val ptr = ic->heap_pos;
+  ic->heap_pos += n;
+  return ptr;
+}
+
+// Hand the unused end of a worker's chunk back to the parent: the parent's
+// allocation position moves back if it is the last chunk taken, otherwise
+// it is counted as waste.
+// @param ic The worker context
+static void ic_alloc_release(IC* ic) {
+  IC* parent = ic->parent;
+  Val end = ic->heap_end;
+  if (end == 0 || ic->heap_pos == end) return;
+  if (!__atomic_compare_exchange_n(&parent->heap_pos, &end, ic->heap_pos, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    __atomic_fetch_add(&parent->heap_waste, ic->heap_end - ic->heap_pos, __ATOMIC_RELAXED);
+  }
+  ic->heap_pos = ic->heap_end = 0;
+}
+
 // Allocate n consecutive terms in memory.
 // @param ic The IC context
 // @param n Number of terms to allocate
 // @return Location in the heap
-// Does NOT bound check. We'll add a less frequent checker elsewhere.
+// Does NOT bound check: overflowing the heap faults on its guard pages.
+// Workers bump a chunk of the shared heap and only take a new one, with an
+// atomic add on the parent context, when it runs out.
 inline Val ic_alloc(IC* ic, Val n) {
   Val ptr = ic->heap_pos;
-  ic->heap_pos += n;
+  if (ptr + n > ic->heap_end) {
+    return ic_alloc_chunk(ic, n);
+  }
+  ic->heap_pos = ptr + n;
   return ptr;
 }
 
+// Count the heap terms in use, leaving out the unused chunk ends.
+// @param ic The IC context
+// @return Number of allocated terms
+inline Val ic_heap_used(IC* ic) {
+  return ic->heap_pos - ic->heap_waste;
+}
+
+// Allocate a node of n terms (1 to 3).
+// @param ic The IC context
+// @param n Number of terms in the node
+// @return Location in the heap
+// When node reuse is enabled, pops the free list of that size first.
+inline Val ic_alloc_node(IC* ic, Val n) {
+  if (ic->reuse && n < 4) {
+    Val loc = ic->free_list[n];
+    if (loc != NONE) {
+      ic->free_list[n] = ic->heap[loc];
+      return loc;
+    }
+  }
+  return ic_alloc(ic, n);
+}
+
+// Return a consumed node of n terms to its free list, if it has 1 to 3 terms.
+// @param ic The IC context
+// @param loc Location of the node
+// @param n Number of terms in the node
+// Since IC is affine, a node consumed by an interaction is unreachable, so its
+// first term can hold the link to the next free node of the same size.
+inline void ic_free_node(IC* ic, Val loc, Val n) {
+  if (ic->reuse && n > 0 && n < 4) {
+    ic->heap[loc] = ic->free_list[n];
+    ic->free_list[n] = loc;
+  }
+}
+
 // -----------------------------------------------------------------------------
 // Term Manipulation Functions
 // -----------------------------------------------------------------------------
@@ -136,6 +875,37 @@ inline Term ic_make_swi(Val val) {
   return ic_make_term(SWI, 0, val);
 }
 
+// Helper to create a binary operation term
+// @param val Pointer to the operation node
+// @return A binary operation term
+inline Term ic_make_op2(Val val) {
+  return ic_make_term(OP2, 0, val);
+}
+
+// Helper to create a constructor term
+// @param cid The constructor id
+// @param ari The number of fields
+// @param val Pointer to the fields (unused if there are none)
+// @return A constructor term
+inline Term ic_make_ctr(Val cid, Val ari, Val val) {
+  return ic_make_term(CTR, CTR_LAB(cid, ari), val);
+}
+
+// Helper to create a match term
+// @param len The number of branches
+// @param val Pointer to the match node
+// @return A match term
+inline Term ic_make_mat(Val len, Val val) {
+  return ic_make_term(MAT, (Lab)len, val);
+}
+
+// Helper to create a reference term
+// @param id The definition id
+// @return A reference term
+inline Term ic_make_ref(Val id) {
+  return ic_make_term(REF, 0, id);
+}
+
 // Check if a term is an erasure
 // @param term The term to check
 // @return True if the term is an erasure, false otherwise
@@ -145,14 +915,14 @@ inline bool ic_is_era(Term term) {
 
 // Allocs a Lam node
 inline Val ic_lam(IC* ic, Term bod) {
-  Val lam_loc = ic_alloc(ic, 1);
+  Val lam_loc = ic_alloc_node(ic, 1);
   ic->heap[lam_loc + 0] = bod;
   return lam_loc;
 }
 
 // Allocs an App node
 inline Val ic_app(IC* ic, Term fun, Term arg) {
-  Val app_loc = ic_alloc(ic, 2);
+  Val app_loc = ic_alloc_node(ic, 2);
   ic->heap[app_loc + 0] = fun;
   ic->heap[app_loc + 1] = arg;
   return app_loc;
@@ -160,7 +930,7 @@ inline Val ic_app(IC* ic, Term fun, Term arg) {
 
 // Allocs a Sup node
 inline Val ic_sup(IC* ic, Term lft, Term rgt) {
-  Val sup_loc = ic_alloc(ic, 2);
+  Val sup_loc = ic_alloc_node(ic, 2);
   ic->heap[sup_loc + 0] = lft;
   ic->heap[sup_loc + 1] = rgt;
   return sup_loc;
@@ -168,27 +938,169 @@ inline Val ic_sup(IC* ic, Term lft, Term rgt) {
 
 // Allocs a Dup node
 inline Val ic_dup(IC* ic, Term val) {
-  Val dup_loc = ic_alloc(ic, 1);
+  Val dup_loc = ic_alloc_node(ic, 1);
   ic->heap[dup_loc] = val;
   return dup_loc;
 }
 
 // Allocs a Suc node
 inline Val ic_suc(IC* ic, Term num) {
-  Val suc_loc = ic_alloc(ic, 1);
+  Val suc_loc = ic_alloc_node(ic, 1);
   ic->heap[suc_loc] = num;
   return suc_loc;
 }
 
 // Allocs a Swi node
 inline Val ic_swi(IC* ic, Term num, Term ifz, Term ifs) {
-  Val swi_loc = ic_alloc(ic, 3);
+  Val swi_loc = ic_alloc_node(ic, 3);
   ic->heap[swi_loc + 0] = num;
   ic->heap[swi_loc + 1] = ifz;
   ic->heap[swi_loc + 2] = ifs;
   return swi_loc;
 }
 
+// Allocs an Op2 node, in phase 0
+inline Val ic_op2(IC* ic, Oper op, Term lft, Term rgt) {
+  Val op2_loc = ic_alloc_node(ic, 3);
+  ic->heap[op2_loc + 0] = lft;
+  ic->heap[op2_loc + 1] = rgt;
+  ic->heap[op2_loc + 2] = ic_make_num(OP2_INFO(op, 0));
+  return op2_loc;
+}
+
+// Allocs a Mat node, leaving its branches to the caller
+inline Val ic_mat(IC* ic, Term val, Val first, Val len) {
+  Val mat_loc = ic_alloc_node(ic, len + 2);
+  ic->heap[mat_loc + 0] = val;
+  ic->heap[mat_loc + 1] = ic_make_num(first);
+  return mat_loc;
+}
+
+// Marker stored in a duplication node while a worker reduces its value. No
+// real term looks like this, since erasures always have a zero value.
+#define IC_LOCK MAKE_TERM(false, ERA, 0, TERM_VAL_MASK)
+
+// Marker stored in the node of an erased lambda, so that its variable, if it
+// is erased too, frees the node.
+#define IC_ERASED MAKE_TERM(false, ERA, 0, TERM_VAL_MASK - 1)
+
+// Store a substitution. This is a release store, so that another thread
+// that reads the substitution also sees the nodes it points to.
+// @param ic The IC context
+// @param loc Location of the variable's binder or duplication node
+// @param val The substituted term
+static inline void ic_subst(IC* ic, Val loc, Term val) {
+  __atomic_store_n(&ic->heap[loc], ic_make_sub(val), __ATOMIC_RELEASE);
+}
+
+
+// Free a discarded term and everything only it points to.
+// @param ic The IC context
+// @param term The discarded term
+// Since IC is affine, a discarded node is unreachable, with two exceptions.
+// The variable of a discarded lambda may occur outside of its body, so its
+// binder is marked with IC_ERASED, and freed if the variable is reached too.
+// A duplication node is shared with the other variable, so the value is
+// moved to a cell of its own, and the node marked with IC_DUP_MOVED: the
+// rule that reduces the value then erases the half meant for this variable
+// (see ic_dup_subst). Neither changes what the other variable reads. Does
+// nothing unless node reuse is enabled. Pending terms are kept on the
+// evaluation stack above stack_pos, so callers must keep stack_pos above
+// their live entries.
+inline void ic_erase(IC* ic, Term term) {
+  if (!ic->reuse) {
+    return;
+  }
+  Term* heap = ic->heap;
+  Term* todo = ic->stack + ic->stack_pos;
+  Val len = 0;
+  todo[len++] = term;
+  while (len > 0) {
+    term = todo[--len];
+    TermTag tag = TERM_TAG(term);
+    Val loc = TERM_VAL(term);
+    Val n;
+    if (tag == VAR) {
+      Term val = __atomic_load_n(&heap[loc], __ATOMIC_ACQUIRE);
+      if (TERM_SUB(val)) {
+        ic_free_node(ic, loc, 1);
+        todo[len++] = ic_clear_sub(val);
+      } else if (val == IC_ERASED) {
+        ic_free_node(ic, loc, 1);
+      }
+      continue;
+    } else if (IS_DUP(tag)) {
+      Term val = __atomic_load_n(&heap[loc], __ATOMIC_ACQUIRE);
+      if (TERM_SUB(val)) {
+        ic_free_node(ic, loc, 1);
+        todo[len++] = ic_clear_sub(val);
+      } else if (IS_DUP_MOVED(val)) {
+        // Both variables are erased
+        Val at = TERM_VAL(val);
+        todo[len++] = heap[at];
+        ic_free_node(ic, at, 1);
+        ic_free_node(ic, loc, 1);
+      } else if (!ic->parent) {
+        // Workers may race on the node, so they leave it as it is
+        Val at = ic_alloc_node(ic, 1);
+        if (at != 0 && at < TERM_VAL_MASK - 1) {
+          heap[at] = val;
+          heap[loc] = IC_DUP_MOVED(at);
+        }
+      }
+      continue;
+    } else if (tag == LAM) {
+      Term bod = heap[loc];
+      heap[loc] = IC_ERASED;
+      todo[len++] = bod;
+      continue;
+    } else if (!ic_has_loc(term)) {
+      continue;
+    }
+    n = ic_node_size(term);
+    for (Val i = n; i > 0; i--) {
+      todo[len++] = heap[loc + i - 1];
+    }
+    ic_free_node(ic, loc, n);
+  }
+}
+
+// Find the cell holding the value of a duplication node: the node itself,
+// unless one of its variables was erased (see ic_erase).
+// @param ic The IC context
+// @param loc Location of the duplication node
+// @return Location of the duplicated value
+inline Val ic_dup_node(IC* ic, Val loc) {
+  Term node = ic->heap[loc];
+  return IS_DUP_MOVED(node) ? TERM_VAL(node) : loc;
+}
+
+// Give the other variable of a duplication its half. If that variable was
+// erased, the half is erased instead, and the node freed.
+// @param ic The IC context
+// @param loc Location of the duplication node
+// @param half The half the other variable reads
+static inline void ic_dup_subst(IC* ic, Val loc, Term half) {
+  Term node = ic->heap[loc];
+  if (IS_DUP_MOVED(node)) {
+    ic_free_node(ic, TERM_VAL(node), 1);
+    ic_free_node(ic, loc, 1);
+    ic_erase(ic, half);
+  } else {
+    ic_subst(ic, loc, half);
+  }
+}
+
+// Find the field an eliminator on the evaluation stack reduces: its first
+// term, or the cell a duplication's value was moved to.
+// @param ic The IC context
+// @param elim The eliminator
+// @return Location of the field
+static inline Val ic_elim_field(IC* ic, Term elim) {
+  Val loc = TERM_VAL(elim);
+  return IS_DUP(TERM_TAG(elim)) ? ic_dup_node(ic, loc) : loc;
+}
+
 // -----------------------------------------------------------------------------
 // Core Interactions
 // -----------------------------------------------------------------------------
@@ -207,7 +1119,10 @@ inline Term ic_app_lam(IC* ic, Term app, Term lam) {
   Term bod = ic->heap[lam_loc + 0];
 
   // Create substitution for the lambda variable
-  ic->heap[lam_loc] = ic_make_sub(arg);
+  ic_subst(ic, lam_loc, arg);
+
+  // The application node is now unreachable
+  ic_free_node(ic, app_loc, 2);
 
   return bod;
 }
@@ -217,6 +1132,8 @@ inline Term ic_app_lam(IC* ic, Term app, Term lam) {
 //*
 inline Term ic_app_era(IC* ic, Term app, Term era) {
   ic->interactions++;
+  ic_erase(ic, ic->heap[TERM_VAL(app) + 1]);
+  ic_free_node(ic, TERM_VAL(app), 2);
   return era; // Return the erasure term
 }
 
@@ -236,8 +1153,8 @@ inline Term ic_app_sup(IC* ic, Term app, Term sup) {
   Term rgt = ic->heap[sup_loc + 1];
 
   // Allocate only what's necessary
-  Val dup_loc = ic_alloc(ic, 1);
-  Val app1_loc = ic_alloc(ic, 2);
+  Val dup_loc = ic_alloc_node(ic, 1);
+  Val app1_loc = ic_alloc_node(ic, 2);
 
   // Store the arg in the duplication location
   ic->heap[dup_loc] = arg;
@@ -278,12 +1195,74 @@ inline Term ic_dup_era(IC* ic, Term dup, Term era) {
   Term era_term = ic_make_era();
 
   // Set substitution
-  ic->heap[dup_loc] = ic_make_sub(era_term);
+  ic_dup_subst(ic, dup_loc, era_term);
 
   // Return an erasure
   return era_term;
 }
 
+// Check that a closed lambda can be duplicated by copying it. A
+// superposition or duplication with the duplication's label would interact
+// with the copies being made instead of being copied itself. The block must
+// also still be self-contained, which rewrites such as the collapser's SUP
+// lifting do not preserve.
+// @param ic The IC context
+// @param loc Location of the lambda's block
+// @param size Number of terms in the block
+// @param lab Label of the duplication
+// @return True if the block can be copied
+static inline bool ic_lam_copyable(IC* ic, Val loc, Val size, Lab lab) {
+  Term* heap = ic->heap + loc;
+  for (Val i = 0; i < size; i++) {
+    Term term = heap[i];
+    TermTag tag = TERM_TAG(term);
+    if (TERM_SUB(term)) {
+      return false;
+    }
+    if ((IS_SUP(tag) || IS_DUP(tag)) && TERM_LAB(term) == lab) {
+      return false;
+    }
+    if (ic_has_loc(term) && (TERM_VAL(term) < loc || TERM_VAL(term) >= loc + size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//! &L{r,s} = λx.f; (closed)
+//K
+//----------------- DUP-LAM (closed)
+//r <- λx.f
+//s <- λy.g (a copy of λx.f)
+//K
+static inline Term ic_dup_lam_copy(IC* ic, Term dup, Term lam) {
+  ic->interactions++;
+
+  Val dup_loc = TERM_VAL(dup);
+  Val lam_loc = TERM_VAL(lam);
+  Val size = LAM_SIZE(lam);
+  bool is_co0 = IS_DP0(TERM_TAG(dup));
+
+  // Copy the lambda's block, moving its pointers to the new location
+  Val loc = ic_alloc(ic, size);
+  Term* src = ic->heap + lam_loc;
+  Term* dst = ic->heap + loc;
+  for (Val i = 0; i < size; i++) {
+    Term term = src[i];
+    dst[i] = ic_has_loc(term) ? term - lam_loc + loc : term;
+  }
+  Term copy = (lam & ~TERM_VAL_MASK) | loc;
+
+  // Keep the original on one side and the copy on the other
+  if (is_co0) {
+    ic_dup_subst(ic, dup_loc, copy);
+    return lam;
+  } else {
+    ic_dup_subst(ic, dup_loc, lam);
+    return copy;
+  }
+}
+
 //! &L{r,s} = λx.f;
 //K
 //----------------- DUP-LAM
@@ -293,6 +1272,10 @@ inline Term ic_dup_era(IC* ic, Term dup, Term era) {
 //! &L{f0,f1} = f;
 //K
 inline Term ic_dup_lam(IC* ic, Term dup, Term lam) {
+  if (LAM_SIZE(lam) > 0 && ic_lam_copyable(ic, TERM_VAL(lam), LAM_SIZE(lam), TERM_LAB(dup))) {
+    return ic_dup_lam_copy(ic, dup, lam);
+  }
+
   ic->interactions++;
 
   Val dup_loc = TERM_VAL(dup);
@@ -303,19 +1286,18 @@ inline Term ic_dup_lam(IC* ic, Term dup, Term lam) {
 
   Term bod = ic->heap[lam_loc + 0];
 
-  // Batch allocate memory for efficiency
-  Val alloc_start = ic_alloc(ic, 5);
-  Val lam0_loc = alloc_start;
-  Val lam1_loc = alloc_start + 1;
-  Val sup_loc = alloc_start + 2; // 2 locations
-  Val dup_new_loc = alloc_start + 4;
+  // Allocate the new nodes (contiguous unless reusing freed ones)
+  Val lam0_loc = ic_alloc_node(ic, 1);
+  Val lam1_loc = ic_alloc_node(ic, 1);
+  Val sup_loc = ic_alloc_node(ic, 2);
+  Val dup_new_loc = ic_alloc_node(ic, 1);
 
   // Set up the superposition
   ic->heap[sup_loc + 0] = ic_make_term(VAR, 0, lam0_loc);
   ic->heap[sup_loc + 1] = ic_make_term(VAR, 0, lam1_loc);
 
   // Replace lambda's variable with the superposition
-  ic->heap[lam_loc] = ic_make_sub(ic_make_sup(dup_lab, sup_loc));
+  ic_subst(ic, lam_loc, ic_make_sup(dup_lab, sup_loc));
 
   // Set up the new duplication
   ic->heap[dup_new_loc] = bod;
@@ -326,10 +1308,10 @@ inline Term ic_dup_lam(IC* ic, Term dup, Term lam) {
 
   // Create and return the appropriate lambda
   if (is_co0) {
-    ic->heap[dup_loc] = ic_make_sub(ic_make_term(LAM, 0, lam1_loc));
+    ic_dup_subst(ic, dup_loc, ic_make_term(LAM, 0, lam1_loc));
     return ic_make_term(LAM, 0, lam0_loc);
   } else {
-    ic->heap[dup_loc] = ic_make_sub(ic_make_term(LAM, 0, lam0_loc));
+    ic_dup_subst(ic, dup_loc, ic_make_term(LAM, 0, lam0_loc));
     return ic_make_term(LAM, 0, lam1_loc);
   }
 }
@@ -365,18 +1347,18 @@ inline Term ic_dup_sup(IC* ic, Term dup, Term sup) {
   // Fast path for matching labels (common case)
   if (dup_lab == sup_lab) {
     // Labels match: simple substitution
+    ic_free_node(ic, sup_loc, 2);
     if (is_co0) {
-      ic->heap[dup_loc] = ic_make_sub(rgt);
+      ic_dup_subst(ic, dup_loc, rgt);
       return lft;
     } else {
-      ic->heap[dup_loc] = ic_make_sub(lft);
+      ic_dup_subst(ic, dup_loc, lft);
       return rgt;
     }
   } else {
     // Labels don't match: create nested duplications
-    Val sup_start = ic_alloc(ic, 4); // 2 sups with 2 terms each
-    Val sup0_loc = sup_start;
-    Val sup1_loc = sup_start + 2;
+    Val sup0_loc = ic_alloc_node(ic, 2);
+    Val sup1_loc = ic_alloc_node(ic, 2);
 
     // Use existing locations as duplication locations
     Val dup_lft_loc = sup_loc + 0;
@@ -395,10 +1377,10 @@ inline Term ic_dup_sup(IC* ic, Term dup, Term sup) {
     ic->heap[dup_rgt_loc] = rgt;
 
     if (is_co0) {
-      ic->heap[dup_loc] = ic_make_sub(ic_make_sup(sup_lab, sup1_loc));
+      ic_dup_subst(ic, dup_loc, ic_make_sup(sup_lab, sup1_loc));
       return ic_make_sup(sup_lab, sup0_loc);
     } else {
-      ic->heap[dup_loc] = ic_make_sub(ic_make_sup(sup_lab, sup0_loc));
+      ic_dup_subst(ic, dup_loc, ic_make_sup(sup_lab, sup0_loc));
       return ic_make_sup(sup_lab, sup1_loc);
     }
   }
@@ -414,6 +1396,7 @@ inline Term ic_dup_sup(IC* ic, Term dup, Term sup) {
 inline Term ic_suc_num(IC* ic, Term suc, Term num) {
   ic->interactions++;
   uint32_t num_val = TERM_VAL(num);
+  ic_free_node(ic, TERM_VAL(suc), 1);
   return ic_make_num(num_val + 1);
 }
 
@@ -422,6 +1405,7 @@ inline Term ic_suc_num(IC* ic, Term suc, Term num) {
 //*
 inline Term ic_suc_era(IC* ic, Term suc, Term era) {
   ic->interactions++;
+  ic_free_node(ic, TERM_VAL(suc), 1);
   return era; // Erasure propagates
 }
 
@@ -437,12 +1421,16 @@ inline Term ic_suc_sup(IC* ic, Term suc, Term sup) {
   Term lft = ic->heap[sup_loc + 0];
   Term rgt = ic->heap[sup_loc + 1];
 
+  // Both the successor and the superposition nodes are consumed
+  ic_free_node(ic, TERM_VAL(suc), 1);
+  ic_free_node(ic, sup_loc, 2);
+
   // Create SUC nodes for each branch
   Val suc0_loc = ic_suc(ic, lft);
   Val suc1_loc = ic_suc(ic, rgt);
 
   // Create the resulting superposition of SUCs
-  Val res_loc = ic_alloc(ic, 2);
+  Val res_loc = ic_alloc_node(ic, 2);
   ic->heap[res_loc + 0] = ic_make_suc(suc0_loc);
   ic->heap[res_loc + 1] = ic_make_suc(suc1_loc);
 
@@ -461,14 +1449,16 @@ inline Term ic_swi_num(IC* ic, Term swi, Term num) {
   Term ifz = ic->heap[swi_loc + 1];
   Term ifs = ic->heap[swi_loc + 2];
 
+  ic_free_node(ic, swi_loc, 3);
+
   if (num_val == 0) {
     // If the number is 0, return the zero branch
+    ic_erase(ic, ifs);
     return ifz;
   } else {
     // Otherwise, apply the successor branch to N-1
-    Val app_loc = ic_alloc(ic, 2);
-    ic->heap[app_loc + 0] = ifs;
-    ic->heap[app_loc + 1] = ic_make_num(num_val - 1);
+    ic_erase(ic, ifz);
+    Val app_loc = ic_app(ic, ifs, ic_make_num(num_val - 1));
     return ic_make_term(APP, 0, app_loc);
   }
 }
@@ -478,6 +1468,9 @@ inline Term ic_swi_num(IC* ic, Term swi, Term num) {
 //*
 inline Term ic_swi_era(IC* ic, Term swi, Term era) {
   ic->interactions++;
+  ic_erase(ic, ic->heap[TERM_VAL(swi) + 1]);
+  ic_erase(ic, ic->heap[TERM_VAL(swi) + 2]);
+  ic_free_node(ic, TERM_VAL(swi), 3);
   return era; // Erasure propagates
 }
 
@@ -498,12 +1491,13 @@ inline Term ic_swi_sup(IC* ic, Term swi, Term sup) {
   Term ifz = ic->heap[swi_loc + 1];
   Term ifs = ic->heap[swi_loc + 2];
 
-  // Create duplications for ifz and ifs branches
-  Val dup_z_loc = ic_alloc(ic, 1);
-  Val dup_s_loc = ic_alloc(ic, 1);
+  // Both the switch and the superposition nodes are consumed
+  ic_free_node(ic, swi_loc, 3);
+  ic_free_node(ic, sup_loc, 2);
 
-  ic->heap[dup_z_loc] = ifz;
-  ic->heap[dup_s_loc] = ifs;
+  // Create duplications for ifz and ifs branches
+  Val dup_z_loc = ic_dup(ic, ifz);
+  Val dup_s_loc = ic_dup(ic, ifs);
 
   Term z0 = ic_make_co0(sup_lab, dup_z_loc);
   Term z1 = ic_make_co1(sup_lab, dup_z_loc);
@@ -515,9 +1509,7 @@ inline Term ic_swi_sup(IC* ic, Term swi, Term sup) {
   Val swi1_loc = ic_swi(ic, rgt, z1, s1);
 
   // Create the resulting superposition
-  Val res_loc = ic_alloc(ic, 2);
-  ic->heap[res_loc + 0] = ic_make_term(SWI, 0, swi0_loc);
-  ic->heap[res_loc + 1] = ic_make_term(SWI, 0, swi1_loc);
+  Val res_loc = ic_sup(ic, ic_make_term(SWI, 0, swi0_loc), ic_make_term(SWI, 0, swi1_loc));
 
   return ic_make_sup(sup_lab, res_loc);
 }
@@ -537,26 +1529,676 @@ inline Term ic_dup_num(IC* ic, Term dup, Term num) {
   bool is_co0 = IS_DP0(dup_tag);
 
   // Numbers are duplicated by simply substituting both variables with the same number
-  ic->heap[dup_loc] = ic_make_sub(num); // Set substitution for the other variable
+  ic_dup_subst(ic, dup_loc, num); // Set substitution for the other variable
 
   return num; // Return the number
 }
 
-// -----------------------------------------------------------------------------
-// Term Normalization
-// -----------------------------------------------------------------------------
+// Source symbols of the binary operators, indexed by Oper
+static const char* const ic_oper_symbols[OPER_COUNT] = {
+  "+", "-", "*", "/", "%", "==", "!=", "<", "<=", ">", ">=", "&", "|", "^", "<<", ">>",
+};
 
-// Reduce a term to weak head normal form (WHNF).
-// 
-// @param ic The IC context
-// @param term The term to reduce
-// @return The term in WHNF
-inline Term ic_whnf(IC* ic, Term term) {
-  Val stop = ic->stack_pos;
-  Term next = term;
+// Get the source symbol of a binary operator.
+// @param op The operator
+// @return The symbol, or "?" if op is out of range
+inline const char* ic_oper_symbol(Oper op) {
+  return (unsigned)op < OPER_COUNT ? ic_oper_symbols[op] : "?";
+}
+
+// Apply a binary operator to two numbers.
+// @param op The operator
+// @param a The left operand
+// @param b The right operand
+// @return The result, truncated to the width of a number
+inline Val ic_oper_apply(Oper op, Val a, Val b) {
+  Val r;
+  switch (op) {
+    case OP_ADD: r = a + b; break;
+    case OP_SUB: r = a - b; break;
+    case OP_MUL: r = a * b; break;
+    case OP_DIV: r = b == 0 ? 0 : a / b; break;
+    case OP_MOD: r = b == 0 ? 0 : a % b; break;
+    case OP_EQ:  r = a == b; break;
+    case OP_NE:  r = a != b; break;
+    case OP_LT:  r = a < b; break;
+    case OP_LE:  r = a <= b; break;
+    case OP_GT:  r = a > b; break;
+    case OP_GE:  r = a >= b; break;
+    case OP_AND: r = a & b; break;
+    case OP_OR:  r = a | b; break;
+    case OP_XOR: r = a ^ b; break;
+    case OP_LSH: r = b >= 8 * sizeof(Val) ? 0 : a << b; break;
+    case OP_RSH: r = b >= 8 * sizeof(Val) ? 0 : a >> b; break;
+    default:     r = 0; break;
+  }
+  return r & TERM_VAL_MASK;
+}
+
+//(N op y)
+//---------- OP2-NUM (phase 0)
+//(N op y) reducing y
+//
+//(N op M)
+//---------- OP2-NUM (phase 1)
+//N op M
+inline Term ic_op2_num(IC* ic, Term op2, Term num) {
+  ic->interactions++;
+
+  Val op2_loc = TERM_VAL(op2);
+  Term info = ic->heap[op2_loc + 2];
+  Oper op = OP2_OPER(info);
+
+  if (OP2_PHASE(info) == 0) {
+    // Keep the left number and go on to reduce the right operand
+    ic->heap[op2_loc + 0] = ic->heap[op2_loc + 1];
+    ic->heap[op2_loc + 1] = num;
+    ic->heap[op2_loc + 2] = ic_make_num(OP2_INFO(op, 1));
+    return op2;
+  } else {
+    Val a = TERM_VAL(ic->heap[op2_loc + 1]);
+    ic_free_node(ic, op2_loc, 3);
+    return ic_make_num(ic_oper_apply(op, a, TERM_VAL(num)));
+  }
+}
+
+//(* op y)
+//-------- OP2-ERA
+//*
+inline Term ic_op2_era(IC* ic, Term op2, Term era) {
+  ic->interactions++;
+  ic_erase(ic, ic->heap[TERM_VAL(op2) + 1]);
+  ic_free_node(ic, TERM_VAL(op2), 3);
+  return era; // Erasure propagates
+}
+
+//(&L{a,b} op y)
+//----------------------- OP2-SUP (phase 0)
+//!&L{y0,y1} = y;
+//&L{(a op y0),(b op y1)}
+//
+//(N op &L{a,b})
+//----------------------- OP2-SUP (phase 1)
+//&L{(N op a),(N op b)}
+inline Term ic_op2_sup(IC* ic, Term op2, Term sup) {
+  ic->interactions++;
+
+  Val op2_loc = TERM_VAL(op2);
+  Val sup_loc = TERM_VAL(sup);
+  Lab sup_lab = TERM_LAB(sup);
+
+  Term lft = ic->heap[sup_loc + 0];
+  Term rgt = ic->heap[sup_loc + 1];
+  Term oth = ic->heap[op2_loc + 1];
+  Term info = ic->heap[op2_loc + 2];
+
+  // Both the operation and the superposition nodes are consumed
+  ic_free_node(ic, op2_loc, 3);
+  ic_free_node(ic, sup_loc, 2);
+
+  // The other operand is a number in phase 1, and can be shared as is
+  Term oth0 = oth;
+  Term oth1 = oth;
+  if (OP2_PHASE(info) == 0) {
+    Val dup_loc = ic_dup(ic, oth);
+    oth0 = ic_make_co0(sup_lab, dup_loc);
+    oth1 = ic_make_co1(sup_lab, dup_loc);
+  }
+
+  // Create operation nodes for each branch, in the same phase
+  Val op0_loc = ic_alloc_node(ic, 3);
+  ic->heap[op0_loc + 0] = lft;
+  ic->heap[op0_loc + 1] = oth0;
+  ic->heap[op0_loc + 2] = info;
+  Val op1_loc = ic_alloc_node(ic, 3);
+  ic->heap[op1_loc + 0] = rgt;
+  ic->heap[op1_loc + 1] = oth1;
+  ic->heap[op1_loc + 2] = info;
+
+  // Create the resulting superposition
+  Val res_loc = ic_sup(ic, ic_make_op2(op0_loc), ic_make_op2(op1_loc));
+
+  return ic_make_sup(sup_lab, res_loc);
+}
+
+// -----------------------------------------------------------------------------
+// Data Type Interactions
+// -----------------------------------------------------------------------------
+
+//! &L{x,y} = #C{a,b,...};
+//K
+//------------------------- DUP-CTR
+//x <- #C{a0,b0,...}
+//y <- #C{a1,b1,...}
+//! &L{a0,a1} = a;
+//! &L{b0,b1} = b;
+//...
+//K
+inline Term ic_dup_ctr(IC* ic, Term dup, Term ctr) {
+  ic->interactions++;
+
+  Val dup_loc = TERM_VAL(dup);
+  Lab dup_lab = TERM_LAB(dup);
+  bool is_co0 = IS_DP0(TERM_TAG(dup));
+  Val ctr_loc = TERM_VAL(ctr);
+  Val cid = CTR_CID(ctr);
+  Val ari = CTR_ARI(ctr);
+
+  // Constructors without fields are shared as is
+  if (ari == 0) {
+    ic_dup_subst(ic, dup_loc, ctr);
+    return ctr;
+  }
+
+  // The fields of the original node become the new duplications
+  Val ctr0_loc = ic_alloc_node(ic, ari);
+  Val ctr1_loc = ic_alloc_node(ic, ari);
+  for (Val i = 0; i < ari; i++) {
+    ic->heap[ctr0_loc + i] = ic_make_co0(dup_lab, ctr_loc + i);
+    ic->heap[ctr1_loc + i] = ic_make_co1(dup_lab, ctr_loc + i);
+  }
+
+  Term ctr0 = ic_make_ctr(cid, ari, ctr0_loc);
+  Term ctr1 = ic_make_ctr(cid, ari, ctr1_loc);
+  if (is_co0) {
+    ic_dup_subst(ic, dup_loc, ctr1);
+    return ctr0;
+  } else {
+    ic_dup_subst(ic, dup_loc, ctr0);
+    return ctr1;
+  }
+}
+
+//~#C{a,b,...}{...;#C:λx.λy...f;...}
+//---------------------------------- MAT-CTR
+//x <- a
+//y <- b
+//...
+//f
+inline Term ic_mat_ctr(IC* ic, Term mat, Term ctr) {
+  ic->interactions++;
+
+  Val mat_loc = TERM_VAL(mat);
+  Val len = MAT_LEN(mat);
+  Val ctr_loc = TERM_VAL(ctr);
+  Val ari = CTR_ARI(ctr);
+  Val idx = CTR_CID(ctr) - TERM_VAL(ic->heap[mat_loc + 1]);
+
+  // A constructor of another type matches no branch
+  if (idx >= len) {
+    for (Val i = 0; i < len; i++) {
+      ic_erase(ic, ic->heap[mat_loc + 2 + i]);
+    }
+    ic_erase(ic, ctr);
+    ic_free_node(ic, mat_loc, len + 2);
+    return ic_make_era();
+  }
+
+  // The other branches are discarded
+  Term res = ic->heap[mat_loc + 2 + idx];
+  for (Val i = 0; i < len; i++) {
+    if (i != idx) {
+      ic_erase(ic, ic->heap[mat_loc + 2 + i]);
+    }
+  }
+  ic_free_node(ic, mat_loc, len + 2);
+
+  // Fields are substituted into the branch's lambdas directly, and only
+  // applied to it when it is not a lambda
+  for (Val i = 0; i < ari; i++) {
+    Term fld = ic->heap[ctr_loc + i];
+    if (TERM_TAG(res) == LAM) {
+      Val lam_loc = TERM_VAL(res);
+      res = ic->heap[lam_loc];
+      ic_subst(ic, lam_loc, fld);
+    } else {
+      res = ic_make_term(APP, 0, ic_app(ic, res, fld));
+    }
+  }
+  ic_free_node(ic, ctr_loc, ari);
+
+  return res;
+}
+
+//~*{...}
+//------- MAT-ERA
+//*
+inline Term ic_mat_era(IC* ic, Term mat, Term era) {
+  ic->interactions++;
+  for (Val i = 0; i < MAT_LEN(mat); i++) {
+    ic_erase(ic, ic->heap[TERM_VAL(mat) + 2 + i]);
+  }
+  ic_free_node(ic, TERM_VAL(mat), MAT_LEN(mat) + 2);
+  return era; // Erasure propagates
+}
+
+//~&L{x,y}{#A:a;#B:b;...}
+//----------------------------------------- MAT-SUP
+//!&L{a0,a1} = a;
+//!&L{b0,b1} = b;
+//...
+//&L{~x{#A:a0;#B:b0;...},~y{#A:a1;#B:b1;...}}
+inline Term ic_mat_sup(IC* ic, Term mat, Term sup) {
+  ic->interactions++;
+
+  Val mat_loc = TERM_VAL(mat);
+  Val len = MAT_LEN(mat);
+  Val first = TERM_VAL(ic->heap[mat_loc + 1]);
+  Val sup_loc = TERM_VAL(sup);
+  Lab sup_lab = TERM_LAB(sup);
+
+  Term lft = ic->heap[sup_loc + 0];
+  Term rgt = ic->heap[sup_loc + 1];
+  ic_free_node(ic, sup_loc, 2);
+
+  // Create match nodes for each side, duplicating every branch
+  Val mat0_loc = ic_mat(ic, lft, first, len);
+  Val mat1_loc = ic_mat(ic, rgt, first, len);
+  for (Val i = 0; i < len; i++) {
+    Val dup_loc = ic_dup(ic, ic->heap[mat_loc + 2 + i]);
+    ic->heap[mat0_loc + 2 + i] = ic_make_co0(sup_lab, dup_loc);
+    ic->heap[mat1_loc + 2 + i] = ic_make_co1(sup_lab, dup_loc);
+  }
+  ic_free_node(ic, mat_loc, len + 2);
+
+  // Create the resulting superposition
+  Val res_loc = ic_sup(ic, ic_make_mat(len, mat0_loc), ic_make_mat(len, mat1_loc));
+
+  return ic_make_sup(sup_lab, res_loc);
+}
+
+// -----------------------------------------------------------------------------
+// Top-Level Definitions
+// -----------------------------------------------------------------------------
+
+//@F
+//----- REF
+//F (a fresh copy)
+inline Term ic_ref(IC* ic, Term ref) {
+  ic->interactions++;
+
+  ICDef* def = &ic->defs[TERM_VAL(ref)];
+  Val size = def->size;
+  Term* terms = def->terms;
+
+  // Copy the template in one block, moving its pointers to the new location
+  Val loc = ic_alloc(ic, size);
+  Term* heap = ic->heap + loc;
+  for (Val i = 0; i < size; i++) {
+    Term term = terms[i];
+    heap[i] = ic_has_loc(term) ? term + loc : term;
+  }
+
+  return ic_has_loc(def->root) ? def->root + loc : def->root;
+}
+
+// -----------------------------------------------------------------------------
+// Garbage Collection
+// -----------------------------------------------------------------------------
+
+// State of a collection in progress.
+typedef struct {
+  Term* from;     // From-space: the heap, or a definition's template
+  Term* to;       // To-space, copied back to the front of the heap at the end
+  Val to_pos;     // Allocation position in the to-space
+  uint64_t* fwd;  // Bitmap of heap locations already moved
+  Val* todo;      // To-space locations still holding unrelocated terms
+  Val todo_len;
+} GC;
+
+// Each to-space location is pushed once, so the work list never holds more
+// entries than the from-space has terms.
+static inline void ic_gc_todo(GC* gc, Val loc) {
+  gc->todo[gc->todo_len++] = loc;
+}
+
+// Moves the node a term points to into the to-space, unless it was already
+// moved, and returns the term pointing to its new location. Every moved
+// location keeps its new address in the from-space, so the variables and
+// substitutions sharing a node all end up pointing to the same copy.
+// A variable whose binder holds a substitution is its only remaining reader,
+// so it is replaced by the substituted term, and the cell is dropped.
+static inline Term ic_gc_move(GC* gc, Term term) {
+  Term* heap = gc->from;
+  Term sub = term & TERM_SUB_MASK;
+  term = ic_clear_sub(term);
+  Val n;
+  Val loc;
+  while (1) {
+    n = ic_node_size(term);
+    if (n == 0) {
+      return term | sub;
+    }
+    loc = TERM_VAL(term);
+    if (gc->fwd[loc / 64] & (1ULL << (loc % 64))) {
+      return (term & ~TERM_VAL_MASK) | heap[loc] | sub;
+    }
+    TermTag tag = TERM_TAG(term);
+    if ((tag == VAR || IS_DUP(tag)) && TERM_SUB(heap[loc])) {
+      term = ic_clear_sub(heap[loc]);
+      continue;
+    }
+    break;
+  }
+  Val new_loc = gc->to_pos;
+  gc->to_pos += n;
+  for (Val i = 0; i < n; i++) {
+    gc->to[new_loc + i] = heap[loc + i];
+    gc->fwd[(loc + i) / 64] |= 1ULL << ((loc + i) % 64);
+    heap[loc + i] = new_loc + i;
+  }
+  // Fields are pushed in reverse, so the graph is laid out in depth-first
+  // order, visiting the first field (the one whnf descends into) first.
+  for (Val i = n; i > 0; i--) {
+    ic_gc_todo(gc, new_loc + i - 1);
+  }
+  return (term & ~TERM_VAL_MASK) | new_loc | sub;
+}
+
+// Moves a root term and everything reachable from it.
+static inline Term ic_gc_root(GC* gc, Term term) {
+  term = ic_gc_move(gc, term);
+  while (gc->todo_len > 0) {
+    Val loc = gc->todo[--gc->todo_len];
+    gc->to[loc] = ic_gc_move(gc, gc->to[loc]);
+  }
+  return term;
+}
+
+// Set up a collection of a definition's template.
+// @return False if memory ran out
+static bool ic_gc_init(GC* gc, Term* from, Val size) {
+  gc->from = from;
+  gc->to = (Term*)malloc((size + 1) * sizeof(Term));
+  gc->to_pos = 0;
+  gc->fwd = (uint64_t*)calloc(size / 64 + 1, sizeof(uint64_t));
+  gc->todo_len = 0;
+  gc->todo = (Val*)malloc((size + 1) * sizeof(Val));
+  if (!gc->to || !gc->fwd || !gc->todo) {
+    free(gc->to);
+    free(gc->fwd);
+    free(gc->todo);
+    return false;
+  }
+  return true;
+}
+
+// Reserve the space for collecting the heap: a to-space, a moved bitmap and
+// a work list, each as large as the heap can need. Like the heap, it is only
+// committed when touched, and it is reserved once.
+// @return False if it could not be reserved
+static bool ic_gc_reserve(IC* ic) {
+  if (ic->gc_space) {
+    return true;
+  }
+  size_t bytes = (size_t)ic->heap_size * sizeof(Term) + ((size_t)ic->heap_size / 64 + 1) * sizeof(uint64_t) +
+                 (size_t)ic->heap_size * sizeof(Val);
+  void* space = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (space == MAP_FAILED) {
+    fprintf(stderr, "Error: Could not reserve space for garbage collection\n");
+    return false;
+  }
+  ic->gc_space = (Term*)space;
+  ic->gc_space_bytes = bytes;
+  return true;
+}
+
+// Enable the compacting collector.
+// @param ic The IC context
+// @return False if the collector's space could not be reserved
+inline bool ic_gc_enable(IC* ic) {
+  if (!ic_gc_reserve(ic)) {
+    return false;
+  }
+  ic->gc_limit = ic->heap_size > 2 * IC_GC_MARGIN ? ic->heap_size - IC_GC_MARGIN : ic->heap_size / 2;
+  return true;
+}
+
+// Compact the heap.
+// @param ic The IC context
+// @param root The root term
+// @return The relocated root term, or NONE if no space could be reserved
+// Reachable nodes are copied to a to-space in depth-first order, then copied
+// back to the front of the heap. Every term on the evaluation stack is a root,
+// and is relocated in place. Free lists are emptied, as all garbage is gone.
+// The to-space pages are released afterwards, which also clears the bitmap.
+inline Term ic_gc(IC* ic, Term root) {
+  if (!ic_gc_reserve(ic)) {
+    return NONE;
+  }
+  GC gc;
+  gc.from = ic->heap;
+  gc.to = ic->gc_space;
+  gc.to_pos = 0;
+  gc.fwd = (uint64_t*)(gc.to + ic->heap_size);
+  gc.todo = (Val*)(gc.fwd + ic->heap_size / 64 + 1);
+  gc.todo_len = 0;
+
+  root = ic_gc_root(&gc, root);
+  for (Val i = 0; i < ic->stack_pos; i++) {
+    ic->stack[i] = ic_gc_root(&gc, ic->stack[i]);
+  }
+
+  memcpy(ic->heap, gc.to, gc.to_pos * sizeof(Term));
+  ic->heap_pos = gc.to_pos;
+  ic->heap_waste = 0;
+  for (Val i = 0; i < 4; i++) {
+    ic->free_list[i] = NONE;
+  }
+
+  madvise(ic->gc_space, ic->gc_space_bytes, MADV_DONTNEED);
+  return root;
+}
+
+// Lay out a freshly parsed program in the order ic_whnf walks it.
+// @param ic The IC context
+// @param root The parsed term
+// @return The relocated term
+// The parser allocates nodes in the order it reads them, so an application's
+// node comes after its function, and let bindings interleave their nodes.
+// This moves the term, and the template of every definition, with the
+// collector, which lays nodes out depth-first, first field first. Closed
+// lambdas are moved as whole blocks, keeping their inner layout.
+inline Term ic_relayout(IC* ic, Term root) {
+  for (Val i = 0; i < ic->def_count; i++) {
+    ICDef* def = &ic->defs[i];
+    if (!def->terms) {
+      continue;
+    }
+    GC gc;
+    if (!ic_gc_init(&gc, def->terms, def->size)) {
+      fprintf(stderr, "Error: Memory allocation failed during relayout\n");
+      return NONE;
+    }
+    def->root = ic_gc_root(&gc, def->root);
+    free(def->terms);
+    def->terms = gc.to;
+    def->size = gc.to_pos;
+    free(gc.fwd);
+    free(gc.todo);
+  }
+  return ic_gc(ic, root);
+}
+
+// Collects garbage from inside ic_whnf, between two interactions.
+// @param ic The IC context
+// @param next The term being reduced
+// @param stop Stack position where the current ic_whnf call started
+// @return The relocated term being reduced
+// The eliminators in stack[stop..] still point to the terms they had before
+// their fields were reduced, which may since have been consumed. These fields
+// are first rewritten to the pending chain, so that no stale term is traced.
+static Term ic_gc_whnf(IC* ic, Term next, Val stop) {
+  Term child = next;
+  for (Val i = ic->stack_pos; i > stop; i--) {
+    Term prev = ic->stack[i - 1];
+    ic->heap[ic_elim_field(ic, prev)] = child;
+    child = prev;
+  }
+  Term moved = ic_gc(ic, next);
+  if (moved == NONE) {
+    ic->gc_limit = NONE;
+    return next;
+  }
+  // Collecting again soon would free just as little: stop collecting, and
+  // let the heap's guard report it if it does fill up
+  if (ic->heap_size - ic->heap_pos < ic->heap_size / IC_GC_MIN_FREE) {
+    fprintf(stderr, "Warning: Only %llu of %llu heap terms free after collection. Collection turned off.\n",
+            (unsigned long long)(ic->heap_size - ic->heap_pos), (unsigned long long)ic->heap_size);
+    ic->gc_limit = NONE;
+  }
+  return moved;
+}
+
+// Collects garbage if the heap is nearly full. Called by ic_whnf only after
+// interactions that allocate, which keeps the check off the other paths.
+// @param ic The IC context
+// @param next The term being reduced
+// @param stop Stack position where the current ic_whnf call started
+// @param stack_pos Current stack position of ic_whnf
+// @return The (possibly relocated) term being reduced
+static inline Term ic_gc_check(IC* ic, Term next, Val stop, Val stack_pos) {
+  if (ic->heap_pos >= ic->gc_limit) {
+    ic->stack_pos = stack_pos;
+    next = ic_gc_whnf(ic, next, stop);
+  }
+  return next;
+}
+
+// -----------------------------------------------------------------------------
+// Term Normalization
+// -----------------------------------------------------------------------------
+
+// Take a duplication node for reduction by a worker thread. Its value is
+// swapped for IC_LOCK, which the interaction (or the parent chain update when
+// the value gets stuck) later replaces, releasing the node. Threads that find
+// it locked wait until it is released. A node whose value was moved is not
+// locked, since only one of its variables is left.
+// @param ic The IC context
+// @param loc Location of the duplication node
+// @return The duplicated value, or a substitution if the node was resolved
+Term ic_dup_lock(IC* ic, Val loc) {
+  while (1) {
+    Term val = __atomic_load_n(&ic->heap[loc], __ATOMIC_ACQUIRE);
+    if (TERM_SUB(val) || IS_DUP_MOVED(val)) {
+      return val;
+    }
+    if (val != IC_LOCK && __atomic_compare_exchange_n(&ic->heap[loc], &val, IC_LOCK, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      return val;
+    }
+    sched_yield();
+  }
+}
+
+// Interactions, as found in the dispatch table of ic_whnf.
+typedef enum {
+  RULE_NONE,
+  RULE_APP_LAM,
+  RULE_APP_SUP,
+  RULE_APP_ERA,
+  RULE_DUP_LAM,
+  RULE_DUP_SUP,
+  RULE_DUP_ERA,
+  RULE_DUP_NUM,
+  RULE_SUC_NUM,
+  RULE_SUC_SUP,
+  RULE_SUC_ERA,
+  RULE_SWI_NUM,
+  RULE_SWI_SUP,
+  RULE_SWI_ERA,
+  RULE_OP2_NUM,
+  RULE_OP2_SUP,
+  RULE_OP2_ERA,
+  RULE_DUP_CTR,
+  RULE_MAT_CTR,
+  RULE_MAT_SUP,
+  RULE_MAT_ERA,
+  IC_RULE_COUNT
+} Rule;
+
+// Check whether the top n entries of the stack above stop are applications,
+// giving a compiled definition its arguments.
+static inline bool ic_ref_applied(Term* stack, Val stack_pos, Val stop, Val n) {
+  if (stack_pos - stop < n) {
+    return false;
+  }
+  for (Val i = 1; i <= n; i++) {
+    if (TERM_TAG(stack[stack_pos - i]) != APP) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Tags of the eliminators that ic_whnf descends into through their first
+// field, as a bit set. Duplications are handled apart, since they may be
+// resolved. Tags outside the term layout (MAT in IC32) never match.
+#define IC_ELIMS \
+  ((1ULL << APP) | (1ULL << SUC) | (1ULL << SWI) | (1ULL << OP2) | \
+   (MAT < TERM_TAG_COUNT ? 1ULL << (MAT % 64) : 0))
+
+// Interaction to apply, indexed by the tag of the eliminator on the stack and
+// the tag of the term in WHNF that it meets.
+static uint8_t ic_rules[TERM_TAG_COUNT][TERM_TAG_COUNT];
+
+// Fill the dispatch table. Labelled tags (and the 32-bit label ranges) are
+// expanded here, so ic_whnf needs a single lookup per interaction.
+static void ic_rules_init(void) {
+  for (Val p = 0; p < TERM_TAG_COUNT; p++) {
+    for (Val t = 0; t < TERM_TAG_COUNT; t++) {
+      Rule rule = RULE_NONE;
+      if (p == APP) {
+        if (t == LAM) rule = RULE_APP_LAM;
+        else if (IS_SUP(t)) rule = RULE_APP_SUP;
+        else if (t == ERA) rule = RULE_APP_ERA;
+      } else if (IS_DUP(p)) {
+        if (t == LAM) rule = RULE_DUP_LAM;
+        else if (IS_SUP(t)) rule = RULE_DUP_SUP;
+        else if (t == ERA) rule = RULE_DUP_ERA;
+        else if (t == NUM) rule = RULE_DUP_NUM;
+        else if (t == CTR) rule = RULE_DUP_CTR;
+      } else if (p == SUC) {
+        if (t == NUM) rule = RULE_SUC_NUM;
+        else if (IS_SUP(t)) rule = RULE_SUC_SUP;
+        else if (t == ERA) rule = RULE_SUC_ERA;
+      } else if (p == SWI) {
+        if (t == NUM) rule = RULE_SWI_NUM;
+        else if (IS_SUP(t)) rule = RULE_SWI_SUP;
+        else if (t == ERA) rule = RULE_SWI_ERA;
+      } else if (p == OP2) {
+        if (t == NUM) rule = RULE_OP2_NUM;
+        else if (IS_SUP(t)) rule = RULE_OP2_SUP;
+        else if (t == ERA) rule = RULE_OP2_ERA;
+      } else if (p == MAT) {
+        if (t == CTR) rule = RULE_MAT_CTR;
+        else if (IS_SUP(t)) rule = RULE_MAT_SUP;
+        else if (t == ERA) rule = RULE_MAT_ERA;
+      }
+      ic_rules[p][t] = rule;
+    }
+  }
+}
+
+// Reduce a term to weak head normal form (WHNF).
+// A bounded call suspends once ic->interactions reaches ic->fuel_end. Its
+// stack stays on ic->stack, and the term it was reducing is kept in the
+// context, so that a bounded call on NONE resumes it.
+// @param ic The IC context
+// @param term The term to reduce (NONE to resume)
+// @param bounded Whether to suspend when the fuel runs out
+// @return The term in WHNF, or NONE if suspended
+static Term ic_whnf_go(IC* ic, Term term, bool bounded) {
+  Val stop = ic->stack_pos;
+  Term next = term;
   Term* heap = ic->heap;
   Term* stack = ic->stack;
   Val stack_pos = stop;
+  uint64_t fuel_end = bounded ? ic->fuel_end : UINT64_MAX;
+  if (bounded && term == NONE) {
+    stop = ic->susp_stop;
+    next = ic->susp_next;
+    ic->susp_next = NONE;
+  }
 
   TermTag tag;
   Val val_loc;
@@ -579,28 +2221,44 @@ inline Term ic_whnf(IC* ic, Term term) {
     } else if (IS_DUP(tag)) {
       val_loc = TERM_VAL(next);
       val = heap[val_loc];
+      if (!TERM_SUB(val) && ic->parent) {
+        val = ic_dup_lock(ic, val_loc);
+      }
       if (TERM_SUB(val)) {
         next = ic_clear_sub(val);
         continue;
       } else {
         stack[stack_pos++] = next;
-        next = val;
+        next = IS_DUP_MOVED(val) ? heap[TERM_VAL(val)] : val;
         continue;
       }
-    } else if (tag == APP) {
-      val_loc = TERM_VAL(next);
-      stack[stack_pos++] = next;
-      next = heap[val_loc]; // Reduce the function part
-      continue;
-    } else if (tag == SUC) {
+    } else if ((IC_ELIMS >> tag) & 1) {
+      // APP, SUC, SWI, OP2 and MAT: reduce the function, the number, the
+      // current operand or the scrutinee, which is always the first field
       val_loc = TERM_VAL(next);
+      PREFETCH(&heap[val_loc + 1]); // The argument, read by the interaction
       stack[stack_pos++] = next;
-      next = heap[val_loc]; // Reduce the inner term
+      next = heap[val_loc];
       continue;
-    } else if (tag == SWI) {
-      val_loc = TERM_VAL(next);
-      stack[stack_pos++] = next;
-      next = heap[val_loc]; // Reduce the number term
+    } else if (IS_REF(tag)) {
+      ICDef* def = &ic->defs[TERM_VAL(next)];
+      if (def->fun && ic_ref_applied(stack, stack_pos, stop, def->arity)) {
+        // Compiled: take the arguments from the applications on the stack
+        Term args[IC_FUN_MAX_ARITY];
+        for (Val i = 0; i < def->arity; i++) {
+          Val app_loc = TERM_VAL(stack[--stack_pos]);
+          args[i] = heap[app_loc + 1];
+          ic_free_node(ic, app_loc, 2);
+        }
+        ic->interactions += def->arity + 1;
+        next = def->fun(ic, args);
+      } else {
+        next = ic_ref(ic, next);
+      }
+      next = ic_gc_check(ic, next, stop, stack_pos);
+      if (ic->interactions >= fuel_end) {
+        goto suspend; // A reference can expand to itself without interacting
+      }
       continue;
     }
 
@@ -610,58 +2268,152 @@ inline Term ic_whnf(IC* ic, Term term) {
       return next;
     }
 
+    // Out of fuel: leave the interaction to the next call
+    if (ic->interactions >= fuel_end) {
+      goto suspend;
+    }
+
     // Interaction Dispatcher
     prev = stack[--stack_pos];
     ptag = TERM_TAG(prev);
-    if (ptag == APP) {
-      if (tag == LAM) {
-        next = ic_app_lam(ic, prev, next);
-        continue;
-      } else if (IS_SUP(tag)) {
-        next = ic_app_sup(ic, prev, next);
-        continue;
-      } else if (tag == ERA) {
-        next = ic_app_era(ic, prev, next);
-        continue;
-      }
-    } else if (IS_DUP(ptag)) {
-      if (tag == LAM) {
-        next = ic_dup_lam(ic, prev, next);
-        continue;
-      } else if (IS_SUP(tag)) {
-        next = ic_dup_sup(ic, prev, next);
-        continue;
-      } else if (tag == ERA) {
-        next = ic_dup_era(ic, prev, next);
-        continue;
-      } else if (tag == NUM) {
-        next = ic_dup_num(ic, prev, next);
-        continue;
-      }
-    } else if (ptag == SUC) {
-      if (tag == NUM) {
-        next = ic_suc_num(ic, prev, next);
-        continue;
-      } else if (IS_SUP(tag)) {
-        next = ic_suc_sup(ic, prev, next);
-        continue;
-      } else if (tag == ERA) {
-        next = ic_suc_era(ic, prev, next);
-        continue;
-      }
-    } else if (ptag == SWI) {
-      if (tag == NUM) {
-        next = ic_swi_num(ic, prev, next);
-        continue;
-      } else if (IS_SUP(tag)) {
-        next = ic_swi_sup(ic, prev, next);
-        continue;
-      } else if (tag == ERA) {
-        next = ic_swi_era(ic, prev, next);
-        continue;
-      }
+    if (stack_pos > stop) {
+      // The eliminator below meets the result of this interaction next
+      PREFETCH(&heap[TERM_VAL(stack[stack_pos - 1])]);
     }
+    #ifdef __GNUC__
+    static void* const dispatch[IC_RULE_COUNT] = {
+      [RULE_NONE]    = &&rule_none,
+      [RULE_APP_LAM] = &&rule_app_lam,
+      [RULE_APP_SUP] = &&rule_app_sup,
+      [RULE_APP_ERA] = &&rule_app_era,
+      [RULE_DUP_LAM] = &&rule_dup_lam,
+      [RULE_DUP_SUP] = &&rule_dup_sup,
+      [RULE_DUP_ERA] = &&rule_dup_era,
+      [RULE_DUP_NUM] = &&rule_dup_num,
+      [RULE_SUC_NUM] = &&rule_suc_num,
+      [RULE_SUC_SUP] = &&rule_suc_sup,
+      [RULE_SUC_ERA] = &&rule_suc_era,
+      [RULE_SWI_NUM] = &&rule_swi_num,
+      [RULE_SWI_SUP] = &&rule_swi_sup,
+      [RULE_SWI_ERA] = &&rule_swi_era,
+      [RULE_OP2_NUM] = &&rule_op2_num,
+      [RULE_OP2_SUP] = &&rule_op2_sup,
+      [RULE_OP2_ERA] = &&rule_op2_era,
+      [RULE_DUP_CTR] = &&rule_dup_ctr,
+      [RULE_MAT_CTR] = &&rule_mat_ctr,
+      [RULE_MAT_SUP] = &&rule_mat_sup,
+      [RULE_MAT_ERA] = &&rule_mat_era,
+    };
+    goto *dispatch[ic_rules[ptag][tag]];
+    #else
+    switch (ic_rules[ptag][tag]) {
+      case RULE_APP_LAM: goto rule_app_lam;
+      case RULE_APP_SUP: goto rule_app_sup;
+      case RULE_APP_ERA: goto rule_app_era;
+      case RULE_DUP_LAM: goto rule_dup_lam;
+      case RULE_DUP_SUP: goto rule_dup_sup;
+      case RULE_DUP_ERA: goto rule_dup_era;
+      case RULE_DUP_NUM: goto rule_dup_num;
+      case RULE_SUC_NUM: goto rule_suc_num;
+      case RULE_SUC_SUP: goto rule_suc_sup;
+      case RULE_SUC_ERA: goto rule_suc_era;
+      case RULE_SWI_NUM: goto rule_swi_num;
+      case RULE_SWI_SUP: goto rule_swi_sup;
+      case RULE_SWI_ERA: goto rule_swi_era;
+      case RULE_OP2_NUM: goto rule_op2_num;
+      case RULE_OP2_SUP: goto rule_op2_sup;
+      case RULE_OP2_ERA: goto rule_op2_era;
+      case RULE_DUP_CTR: goto rule_dup_ctr;
+      case RULE_MAT_CTR: goto rule_mat_ctr;
+      case RULE_MAT_SUP: goto rule_mat_sup;
+      case RULE_MAT_ERA: goto rule_mat_era;
+      default:           goto rule_none;
+    }
+    #endif
 
+    rule_app_lam:
+      next = ic_app_lam(ic, prev, next);
+      continue;
+    rule_app_sup:
+      next = ic_app_sup(ic, prev, next);
+      next = ic_gc_check(ic, next, stop, stack_pos);
+      continue;
+    rule_app_era:
+      ic->stack_pos = stack_pos; // Above the stack ic_erase uses
+      next = ic_app_era(ic, prev, next);
+      continue;
+    rule_dup_lam:
+      ic->stack_pos = stack_pos; // Above the stack ic_erase uses
+      next = ic_dup_lam(ic, prev, next);
+      next = ic_gc_check(ic, next, stop, stack_pos);
+      continue;
+    rule_dup_sup:
+      ic->stack_pos = stack_pos; // Above the stack ic_erase uses
+      next = ic_dup_sup(ic, prev, next);
+      next = ic_gc_check(ic, next, stop, stack_pos);
+      continue;
+    rule_dup_era:
+      ic->stack_pos = stack_pos; // Above the stack ic_erase uses
+      next = ic_dup_era(ic, prev, next);
+      continue;
+    rule_dup_num:
+      ic->stack_pos = stack_pos; // Above the stack ic_erase uses
+      next = ic_dup_num(ic, prev, next);
+      continue;
+    rule_suc_num:
+      next = ic_suc_num(ic, prev, next);
+      continue;
+    rule_suc_sup:
+      next = ic_suc_sup(ic, prev, next);
+      next = ic_gc_check(ic, next, stop, stack_pos);
+      continue;
+    rule_suc_era:
+      next = ic_suc_era(ic, prev, next);
+      continue;
+    rule_swi_num:
+      ic->stack_pos = stack_pos; // Above the stack ic_erase uses
+      next = ic_swi_num(ic, prev, next);
+      next = ic_gc_check(ic, next, stop, stack_pos);
+      continue;
+    rule_swi_sup:
+      next = ic_swi_sup(ic, prev, next);
+      next = ic_gc_check(ic, next, stop, stack_pos);
+      continue;
+    rule_swi_era:
+      ic->stack_pos = stack_pos; // Above the stack ic_erase uses
+      next = ic_swi_era(ic, prev, next);
+      continue;
+    rule_op2_num:
+      next = ic_op2_num(ic, prev, next);
+      continue;
+    rule_op2_sup:
+      next = ic_op2_sup(ic, prev, next);
+      next = ic_gc_check(ic, next, stop, stack_pos);
+      continue;
+    rule_op2_era:
+      ic->stack_pos = stack_pos; // Above the stack ic_erase uses
+      next = ic_op2_era(ic, prev, next);
+      continue;
+    rule_dup_ctr:
+      ic->stack_pos = stack_pos; // Above the stack ic_erase uses
+      next = ic_dup_ctr(ic, prev, next);
+      next = ic_gc_check(ic, next, stop, stack_pos);
+      continue;
+    rule_mat_ctr:
+      ic->stack_pos = stack_pos; // Above the stack ic_erase uses
+      next = ic_mat_ctr(ic, prev, next);
+      next = ic_gc_check(ic, next, stop, stack_pos);
+      continue;
+    rule_mat_sup:
+      next = ic_mat_sup(ic, prev, next);
+      next = ic_gc_check(ic, next, stop, stack_pos);
+      continue;
+    rule_mat_era:
+      ic->stack_pos = stack_pos; // Above the stack ic_erase uses
+      next = ic_mat_era(ic, prev, next);
+      continue;
+
+    rule_none:
     // No interaction: push term back to stack
     stack[stack_pos++] = prev;
 
@@ -675,47 +2427,181 @@ inline Term ic_whnf(IC* ic, Term term) {
     while (stack_pos > stop) {
       prev = stack[--stack_pos];
       ptag = TERM_TAG(prev);
-      val_loc = TERM_VAL(prev);
-      if (ptag == APP || ptag == SWI || IS_DUP(ptag)) {
-        heap[val_loc] = next;
+      if (ptag == APP || ptag == SUC || ptag == SWI || ptag == OP2 || IS_MAT(ptag) || IS_DUP(ptag)) {
+        __atomic_store_n(&heap[ic_elim_field(ic, prev)], next, __ATOMIC_RELEASE); // Unlocks duplications
       }
       next = prev;
     }
 
     ic->stack_pos = stack_pos;
     return next;
+
+    suspend:
+    // A worker updates the chain above the first duplication it holds, as
+    // above, so that the node is released while it waits
+    if (ic->parent) {
+      Val keep = stop;
+      while (keep < stack_pos && !IS_DUP(TERM_TAG(stack[keep]))) {
+        keep++;
+      }
+      while (stack_pos > keep) {
+        prev = stack[--stack_pos];
+        __atomic_store_n(&heap[ic_elim_field(ic, prev)], next, __ATOMIC_RELEASE);
+        next = prev;
+      }
+    }
+    ic->susp_next = next;
+    ic->susp_stop = stop;
+    ic->stack_pos = stack_pos;
+    return NONE;
   }
 }
 
-// Recursive implementation of normal form reduction
-inline Term ic_normal(IC* ic, Term term) {
-  term = ic_whnf(ic, term);
+// Reduce a term to weak head normal form (WHNF).
+// 
+// @param ic The IC context
+// @param term The term to reduce
+// @return The term in WHNF
+inline Term ic_whnf(IC* ic, Term term) {
+  return ic_whnf_go(ic, term, false);
+}
+
+// Reduce a term towards weak head normal form, doing at most about fuel
+// interactions (a compiled definition runs all of its interactions at once).
+// @param ic The IC context
+// @param term The term to reduce, or NONE to resume a suspended reduction
+// @param fuel Interactions allowed
+// @return The term in WHNF, or NONE if the fuel ran out first
+inline Term ic_whnf_fuel(IC* ic, Term term, uint64_t fuel) {
+  ic->fuel_end = ic->interactions + fuel;
+  return ic_whnf_go(ic, term, true);
+}
+
+// Get the number of fields that ic_normal visits in a term in WHNF.
+static inline Val ic_normal_arity(Term term) {
   TermTag tag = TERM_TAG(term);
-  Val loc = TERM_VAL(term);
-
-  if (ic_is_era(term) || tag == NUM) {
-    // ERA and NUM have no children, so just return them
-    return term;
-  } else if (tag == LAM) {
-    ic->heap[loc] = ic_normal(ic, ic->heap[loc]);
-    return term;
-  } else if (tag == APP) {
-    ic->heap[loc+0] = ic_normal(ic, ic->heap[loc]);
-    ic->heap[loc+1] = ic_normal(ic, ic->heap[loc+1]);
-    return term;
-  } else if (IS_SUP(tag)) {
-    ic->heap[loc+0] = ic_normal(ic, ic->heap[loc]);
-    ic->heap[loc+1] = ic_normal(ic, ic->heap[loc+1]);
-    return term;
-  } else if (tag == SUC) {
-    ic->heap[loc] = ic_normal(ic, ic->heap[loc]);
-    return term;
+  if (tag == LAM || tag == SUC) {
+    return 1;
+  } else if (tag == APP || IS_SUP(tag)) {
+    return 2;
+  } else if (tag == OP2) {
+    return 2; // The operator is not a subterm
   } else if (tag == SWI) {
-    ic->heap[loc+0] = ic_normal(ic, ic->heap[loc]);
-    ic->heap[loc+1] = ic_normal(ic, ic->heap[loc+1]);
-    ic->heap[loc+2] = ic_normal(ic, ic->heap[loc+2]);
-    return term;
+    return 3;
+  } else if (IS_CTR(tag)) {
+    return CTR_ARI(term);
+  } else if (IS_MAT(tag)) {
+    return MAT_LEN(term) + 2; // The first constructor id is a NUM
   } else {
-    return term;
+    return 0; // ERA, NUM and variables have no children
+  }
+}
+
+// Iterative implementation of normal form reduction.
+// Each term whose fields are being normalized has a frame on ic->stack: the
+// term itself, followed by the index of its next field as a NUM. A field is
+// reduced to WHNF and written back right away, then gets a frame of its own.
+// The field is cleared while it is reduced, and the terms stay on the stack,
+// so a garbage collection can relocate them and never traces a consumed
+// subterm. A bounded call that suspends while reducing a field leaves its
+// frames under the stack of ic_whnf, and records where they start.
+static inline Term ic_normal_go(IC* ic, Term term, bool bounded) {
+  Term* stack = ic->stack;
+  Val base;
+  bool resume = bounded && term == NONE && ic->susp_base != NONE;
+  if (resume) {
+    base = ic->susp_base;
+    ic->susp_base = NONE;
+  } else {
+    term = ic_whnf_go(ic, term, bounded);
+    if (term == NONE || ic_normal_arity(term) == 0) {
+      return term;
+    }
+    base = ic->stack_pos;
+    stack[ic->stack_pos++] = term;
+    stack[ic->stack_pos++] = ic_make_num(0);
+  }
+
+  while (1) {
+    Val top = resume ? ic->susp_stop : ic->stack_pos;
+    Term parent = stack[top - 2];
+    Val idx = TERM_VAL(stack[top - 1]);
+
+    // All fields done: pop the frame
+    if (idx == ic_normal_arity(parent)) {
+      ic->stack_pos -= 2;
+      if (ic->stack_pos == base) {
+        return parent;
+      }
+      continue;
+    }
+    stack[top - 1] = ic_make_num(idx + 1);
+
+    Term fld = NONE; // Resumes the suspended reduction of this field
+    if (!resume) {
+      Val loc = TERM_VAL(parent) + idx;
+      fld = ic->heap[loc];
+      ic->heap[loc] = ic_make_era();
+    }
+    resume = false;
+    fld = ic_whnf_go(ic, fld, bounded);
+    if (fld == NONE) {
+      stack[top - 1] = ic_make_num(idx); // Back to this field on resume
+      ic->susp_base = base;
+      return NONE;
+    }
+    ic->heap[TERM_VAL(stack[top - 2]) + idx] = fld;
+
+    if (ic_normal_arity(fld) > 0) {
+      stack[ic->stack_pos++] = fld;
+      stack[ic->stack_pos++] = ic_make_num(0);
+    }
   }
 }
+
+// Reduce a term to full normal form by recursively normalizing subterms.
+// @param ic The IC context
+// @param term The term to normalize
+// @return The normalized term
+inline Term ic_normal(IC* ic, Term term) {
+  return ic_normal_go(ic, term, false);
+}
+
+// Normalize a term, doing at most about fuel interactions.
+// @param ic The IC context
+// @param term The term to normalize, or NONE to resume a suspended normalization
+// @param fuel Interactions allowed
+// @return The normalized term, or NONE if the fuel ran out first
+inline Term ic_normal_fuel(IC* ic, Term term, uint64_t fuel) {
+  ic->fuel_end = ic->interactions + fuel;
+  return ic_normal_go(ic, term, true);
+}
+
+// Drop a suspended reduction, writing the state it kept on the stack back
+// into the heap, as ic_whnf does when a term gets stuck.
+// @param ic The IC context
+// @return The term being reduced, as far as it got (NONE if none was suspended)
+inline Term ic_cancel(IC* ic) {
+  if (ic->susp_next == NONE) {
+    return NONE;
+  }
+  Term next = ic->susp_next;
+  while (ic->stack_pos > ic->susp_stop) {
+    Term prev = ic->stack[--ic->stack_pos];
+    __atomic_store_n(&ic->heap[ic_elim_field(ic, prev)], next, __ATOMIC_RELEASE);
+    next = prev;
+  }
+  ic->susp_next = NONE;
+  if (ic->susp_base == NONE) {
+    return next;
+  }
+
+  // Put the field back into the term being normalized
+  Val top = ic->stack_pos;
+  Val idx = TERM_VAL(ic->stack[top - 1]);
+  ic->heap[TERM_VAL(ic->stack[top - 2]) + idx] = next;
+  Term root = ic->stack[ic->susp_base];
+  ic->stack_pos = ic->susp_base;
+  ic->susp_base = NONE;
+  return root;
+}
@@ -27,6 +27,38 @@
   #define IC_DEFAULT_STACK_SIZE (1UL << 24) // 16M terms
 #endif
 
+// Largest heap that term pointers can address
+#define IC_MAX_HEAP_SIZE ((uint64_t)TERM_VAL_MASK + 1)
+
+// Inaccessible region mapped after the heap and the stack. Writing past
+// either one faults here and is reported as exhaustion, so allocation and
+// stack pushes need no bounds checks.
+#define IC_GUARD_SIZE (1UL << 16)
+
+// Snapshots smaller than this many pages are copied back whole on restore,
+// since that is cheaper than tracking writes with page faults.
+#define IC_SNAPSHOT_MIN_PAGES 16
+
+// Number of terms a worker thread takes from the shared heap at a time
+#define IC_TLAB_SIZE (1UL << 14)
+
+// Free terms kept in reserve when the collector is enabled. A collection is
+// triggered after an allocating interaction once fewer than this many are left.
+#define IC_GC_MARGIN (1UL << 12)
+
+// A collection must leave at least 1/IC_GC_MIN_FREE of the heap free. If it
+// leaves less, the collector is turned off rather than run again and again.
+#define IC_GC_MIN_FREE 8
+
+// Hint that a heap cell will be used soon (built with `make PREFETCH=1`).
+// ic_whnf issues these for the cells of the interactions ahead of it, so
+// their cache misses overlap with the work in between.
+#if defined(IC_PREFETCH) && defined(__GNUC__)
+  #define PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+  #define PREFETCH(ptr) ((void)0)
+#endif
+
 // -----------------------------------------------------------------------------
 // Core Types and Constants
 // -----------------------------------------------------------------------------
@@ -43,6 +75,10 @@
     SUP = 0x07, // Superposition
     DPX = 0x08, // Duplication variable 0
     DPY = 0x09, // Duplication variable 1
+    OP2 = 0x0A, // Binary numeric operation
+    CTR = 0x0B, // Constructor
+    MAT = 0x0C, // Pattern match
+    REF = 0x0D, // Reference to a top-level definition
   } TermTag;
 
   // Term 64-bit packed representation
@@ -58,6 +94,7 @@
 
   #define NONE 0xFFFFFFFFFFFFFFFFULL
   #define LAB_MAX 0xFFFF
+  #define TERM_TAG_COUNT 16 // Tags in use are below this
 
 // Term component extraction
   #define TERM_SUB(term) (((term) & TERM_SUB_MASK) != 0)
@@ -74,6 +111,10 @@
   #define IS_NUM(tag) ((tag) == NUM)
   #define IS_SUC(tag) ((tag) == SUC)
   #define IS_SWI(tag) ((tag) == SWI)
+  #define IS_OP2(tag) ((tag) == OP2)
+  #define IS_CTR(tag) ((tag) == CTR)
+  #define IS_MAT(tag) ((tag) == MAT)
+  #define IS_REF(tag) ((tag) == REF)
   #define SUP_BASE_TAG ((TermTag)(SUP))
   #define DP0_BASE_TAG ((TermTag)(DPX))
   #define DP1_BASE_TAG ((TermTag)(DPY))
@@ -92,7 +133,7 @@
     NUM = 0x04, // Number
     SUC = 0x05, // Successor
     SWI = 0x06, // Switch
-    TMP = 0x07, // Temporary
+    OP2 = 0x07, // Binary numeric operation
     SP0 = 0x08, // Superposition with label 0
     SP1 = 0x09, // Superposition with label 1
     SP2 = 0x0A, // Superposition with label 2
@@ -117,6 +158,10 @@
     DY5 = 0x1D, // Duplication variable 1 with label 5
     DY6 = 0x1E, // Duplication variable 1 with label 6
     DY7 = 0x1F, // Duplication variable 1 with label 7
+    // No tags are left for these in IC32: they only exist in the 64-bit build
+    CTR = 0x20, // Constructor
+    MAT = 0x21, // Pattern match
+    REF = 0x22, // Reference to a top-level definition
   } TermTag;
 
   // Term 32-bit packed representation
@@ -131,6 +176,7 @@
 
   #define NONE 0xFFFFFFFF
   #define LAB_MAX 0x7
+  #define TERM_TAG_COUNT 32
 
   // Term component extraction
   #define TERM_SUB(term) (((term) & TERM_SUB_MASK) != 0)
@@ -147,6 +193,10 @@
   #define IS_NUM(tag) ((tag) == NUM)
   #define IS_SUC(tag) ((tag) == SUC)
   #define IS_SWI(tag) ((tag) == SWI)
+  #define IS_OP2(tag) ((tag) == OP2)
+  #define IS_CTR(tag) false
+  #define IS_MAT(tag) false
+  #define IS_REF(tag) false
   #define SUP_BASE_TAG ((TermTag)(SP0))
   #define DP0_BASE_TAG ((TermTag)(DX0))
   #define DP1_BASE_TAG ((TermTag)(DY0))
@@ -158,23 +208,168 @@
     ((Term)(val) & TERM_VAL_MASK))
 #endif
 
+// Binary numeric operators. An OP2 node holds three terms: the operand being
+// reduced, the other operand, and a NUM with the operator and the phase.
+// In phase 0 the left operand is reduced first; once it is a number the
+// operands are swapped and the node moves to phase 1 to reduce the right one.
+// Comparisons give 1 or 0, division and remainder by zero give 0, and
+// results wrap around to the width of a number.
+typedef enum {
+  OP_ADD = 0x0, // +
+  OP_SUB = 0x1, // -
+  OP_MUL = 0x2, // *
+  OP_DIV = 0x3, // /
+  OP_MOD = 0x4, // %
+  OP_EQ  = 0x5, // ==
+  OP_NE  = 0x6, // !=
+  OP_LT  = 0x7, // <
+  OP_LE  = 0x8, // <=
+  OP_GT  = 0x9, // >
+  OP_GE  = 0xA, // >=
+  OP_AND = 0xB, // &
+  OP_OR  = 0xC, // |
+  OP_XOR = 0xD, // ^
+  OP_LSH = 0xE, // <<
+  OP_RSH = 0xF, // >>
+} Oper;
+
+#define OPER_COUNT 16
+
+// OP2 node fields: operator and phase, packed in the NUM of the third term
+#define OP2_INFO(op, phase) (((Val)(op) << 1) | (phase))
+#define OP2_OPER(info) ((Oper)(TERM_VAL(info) >> 1))
+#define OP2_PHASE(info) (TERM_VAL(info) & 1)
+
+// Algebraic data types. A CTR term points to a node with its fields, and its
+// label packs the constructor id with the arity. A MAT term points to a node
+// holding the scrutinee, a NUM with the id of the first constructor of the
+// matched type, and one branch per constructor, in declaration order. Its
+// label is the number of branches. Both need the 64-bit build.
+#define IC_HAS_CTR (CTR < TERM_TAG_COUNT)
+#define IC_CTR_MAX (1UL << 12) // Constructor ids
+#define IC_CTR_MAX_ARITY 15
+
+#define CTR_LAB(cid, ari) ((Lab)(((cid) << 4) | (ari)))
+#define CTR_CID(term) ((Val)(TERM_LAB(term) >> 4))
+#define CTR_ARI(term) ((Val)(TERM_LAB(term) & 0xF))
+#define MAT_LEN(term) ((Val)TERM_LAB(term))
+
+// A declared constructor.
+typedef struct {
+  char* name;     // Name, without the leading '#'
+  Val arity;      // Number of fields
+  Val first;      // Id of the first constructor of its type
+  Val count;      // Number of constructors of its type
+} ICCtr;
+
+// Top-level definitions. A REF term holds the id of a definition in its
+// value, and ic_whnf expands it by copying the definition's template into the
+// heap, relocating its pointers. Like data types, they need the 64-bit build.
+#define IC_HAS_REF (REF < TERM_TAG_COUNT)
+
+// Most arguments a compiled definition can take (see ic_def_native)
+#define IC_FUN_MAX_ARITY 16
+
+struct IC;
+
+// Compiled body of a definition: builds the body of its leading lambdas,
+// with the arguments in place of their variables.
+typedef Term (*ICFun)(struct IC* ic, Term* args);
+
+// A top-level definition.
+typedef struct {
+  char* name;     // Name, without the leading '@'
+  Term* terms;    // Template nodes, with locations relative to 0 (NULL if not defined yet)
+  Val size;       // Number of terms in the template
+  Term root;      // The definition's body, with relative locations
+  ICFun fun;      // Compiled body (NULL if interpreted)
+  Val arity;      // Number of arguments taken by fun
+} ICDef;
+
+// Closed lambdas. The parser lays out a lambda's body right after its node,
+// so a lambda without free variables or redexes spans a block of the heap
+// that nothing outside points into. Its label holds the size of that block,
+// and DUP-LAM copies it whole instead of layer by layer. The 32-bit build has
+// no room for the size, so every lambda is duplicated lazily there.
+#ifdef IC_64BIT
+  #define LAM_SIZE(term) ((Val)TERM_LAB(term)) // 0 if not known to be closed
+  #define LAM_SIZE_MAX IC_GC_MARGIN // Copies fit in the collector's reserve
+#else
+  #define LAM_SIZE(term) ((Val)0)
+  #define LAM_SIZE_MAX 0
+#endif
+
 // -----------------------------------------------------------------------------
 // IC Structure
 // -----------------------------------------------------------------------------
 
+// Page backing for the heap and stack.
+typedef enum {
+  IC_PAGES_SMALL = 0, // Regular pages
+  IC_PAGES_THP   = 1, // Transparent huge pages (madvise)
+  IC_PAGES_2M    = 2, // 2MB huge pages (MAP_HUGETLB)
+  IC_PAGES_1G    = 3, // 1GB huge pages (MAP_HUGETLB)
+} ICPages;
+
 // The main Interaction Calculus context structure.
 // Contains all state needed for term evaluation.
-typedef struct {
+typedef struct IC {
   // Memory management
   Term* heap;          // Heap memory for terms
   Val heap_size;  // Total size of the heap
   Val heap_pos;   // Current allocation position
+  Val heap_end;   // End of the current allocation chunk (NONE if unbounded)
+  Val heap_waste; // Terms skipped at the end of abandoned chunks
+
+  // Node reuse
+  bool reuse;          // Whether consumed nodes are recycled via free lists
+  Val free_list[4];    // Free list heads for 1, 2 and 3 term nodes (NONE if empty)
+
+  // Garbage collection
+  Val gc_limit;        // Heap position that triggers a collection (NONE if disabled)
+  Term* gc_space;      // To-space, moved bitmap and work list (NULL until first needed)
+  size_t gc_space_bytes;
 
   // Evaluation stack
   Term* stack;          // Stack for term evaluation
   Val stack_size;  // Total size of the stack
   Val stack_pos;   // Current stack position
 
+  // Page backing
+  ICPages pages;       // Requested page backing
+  ICPages heap_pages;  // Page backing obtained for the heap
+  ICPages stack_pages; // Page backing obtained for the stack
+
+  // Heap snapshot (see ic_snapshot)
+  Term* snap;              // Copy of the snapshotted pages (NULL if none)
+  Val snap_pos;            // Heap position at the time of the snapshot
+  Val snap_waste;          // Heap waste at the time of the snapshot
+  size_t snap_page_size;   // Granularity of dirty tracking, in bytes
+  size_t snap_pages;       // Number of snapshotted pages
+  uint8_t* snap_dirty;     // Per-page flag: written since the snapshot
+  size_t* snap_dirty_list; // Pages written since the snapshot
+  size_t snap_dirty_len;   // Length of snap_dirty_list
+
+  // Data types
+  ICCtr* ctrs;         // Declared constructors, indexed by id
+  Val ctr_count;       // Number of declared constructors
+
+  // Book of top-level definitions
+  ICDef* defs;         // Definitions, indexed by id
+  Val def_count;       // Number of definitions
+  Val def_cap;         // Capacity of defs
+  Val* def_index;      // Open-addressing hash of names to ids (NONE if empty)
+  Val def_index_size;  // Slots in def_index, a power of 2
+
+  // Threads
+  struct IC* parent;   // Context whose heap a worker shares (NULL if not a worker)
+
+  // Bounded reduction (see ic_whnf_fuel)
+  uint64_t fuel_end;   // Interaction count at which a bounded reduction suspends
+  Term susp_next;      // Term the suspended ic_whnf was reducing (NONE if none)
+  Val susp_stop;       // Stack position where the suspended ic_whnf started
+  Val susp_base;       // Stack position of the frames of a suspended ic_normal (NONE if none)
+
   // Statistics
   uint64_t interactions; // Interaction counter
 } IC;
@@ -190,15 +385,109 @@ void metal_execute_sup_reduction(uint32_t* heap, uint32_t sup_count, uint32_t* s
 #endif
 
 // Create a new IC context with the specified heap and stack sizes.  
+// Huge pages fall back to transparent huge pages, then regular pages.  
 // @param heap_size Number of terms in the heap  
 // @param stack_size Number of terms in the stack  
+// @param pages The page backing to request for the heap and stack  
 // @return A new IC context or NULL if allocation failed  
-IC* ic_new(Val heap_size, Val stack_size);  
+IC* ic_new(Val heap_size, Val stack_size, ICPages pages);  
 
 // Create a new IC context with default heap and stack sizes.  
 // @return A new IC context or NULL if allocation failed  
 IC* ic_default_new();  
 
+// Get the memory available to this process, taking cgroup limits into account.  
+// @return Available memory in bytes (0 if unknown)  
+uint64_t ic_available_memory();
+
+// Take a snapshot of the heap up to the current allocation position.  
+// Later writes to those pages are tracked, so restoring is proportional  
+// to the number of pages that changed.  
+// @param ic The IC context  
+// @return True on success, false if the snapshot could not be allocated  
+bool ic_snapshot(IC* ic);
+
+// Restore the heap to the last snapshot and reset the allocator, the free  
+// lists and the evaluation stack. Does nothing without a snapshot.  
+// @param ic The IC context  
+void ic_restore(IC* ic);
+
+// Drop the snapshot, if any.  
+// @param ic The IC context  
+void ic_snapshot_free(IC* ic);
+
+// Describe a page backing.  
+// @param pages The page backing  
+// @return A short human-readable name  
+const char* ic_pages_name(ICPages pages);
+
+// Create a worker context for another thread. It shares the heap of ic,
+// taking chunks of IC_TLAB_SIZE terms from it to allocate without atomics,
+// and has its own stack, free lists and statistics. Duplications are locked
+// while a worker reduces them.  
+// @param ic The IC context whose heap is shared  
+// @return A new worker context or NULL if allocation failed  
+IC* ic_worker_new(IC* ic);
+
+// Give the calling thread its own signal stack, so that heap and stack  
+// overflows are still reported when its own stack is exhausted. Called at  
+// the start of each thread that reduces terms.  
+// @return The stack to pass to ic_guard_thread_stop, or NULL if the thread  
+// already had one  
+void* ic_guard_thread_start(void);
+
+// Remove a signal stack given by ic_guard_thread_start.  
+// @param alt The stack returned by ic_guard_thread_start  
+void ic_guard_thread_stop(void* alt);
+
+// Take a duplication node for a worker thread, which must then release it by
+// storing its value back or substituting it. Waits while another thread holds
+// it.  
+// @param ic The worker context  
+// @param loc Location of the duplication node  
+// @return The duplicated value, or a substitution if the node was resolved  
+Term ic_dup_lock(IC* ic, Val loc);
+
+// Declare a data type, giving its constructors consecutive ids.  
+// @param ic The IC context  
+// @param names Constructor names, without the leading '#'  
+// @param arities Number of fields of each constructor  
+// @param count Number of constructors  
+// @return The id of the first constructor, or NONE if there are too many  
+Val ic_ctr_declare(IC* ic, const char** names, const Val* arities, Val count);
+
+// Find a declared constructor by name.  
+// @param ic The IC context  
+// @param name The constructor name, without the leading '#'  
+// @return Its id, or NONE if it was not declared  
+Val ic_ctr_find(IC* ic, const char* name);
+
+// Find a top-level definition by name, adding an undefined one if missing.  
+// @param ic The IC context  
+// @param name The definition name, without the leading '@'  
+// @return Its id, or NONE if it could not be added  
+Val ic_def_declare(IC* ic, const char* name);
+
+// Set the body of a top-level definition to a heap segment holding a closed  
+// term. The segment is copied to the book, and can be reused afterwards.  
+// @param ic The IC context  
+// @param id The definition id  
+// @param start First location of the segment  
+// @param end Location after the segment  
+// @param root The body, pointing into the segment  
+// @return True on success, false if the template could not be allocated  
+bool ic_def_set(IC* ic, Val id, Val start, Val end, Term root);
+
+// Attach a compiled body to a definition. When ic_whnf meets a reference to  
+// it applied to at least arity arguments, it calls fun instead of copying  
+// the template and reducing the applications one by one.  
+// @param ic The IC context  
+// @param name The definition name, without the leading '@'  
+// @param arity Number of leading lambdas replaced by fun  
+// @param fun The compiled body  
+// @return True on success, false if there is no such definition  
+bool ic_def_native(IC* ic, const char* name, Val arity, ICFun fun);
+
 // Free all resources associated with an IC context.  
 // @param ic The IC context to free  
 void ic_free(IC* ic);  
@@ -209,6 +498,63 @@ void ic_free(IC* ic);
 // @return The starting location of the allocated block  
 Val ic_alloc(IC* ic, Val n);  
 
+// Count the heap terms in use, leaving out the unused ends of the chunks  
+// taken by workers.  
+// @param ic The IC context  
+// @return Number of allocated terms  
+Val ic_heap_used(IC* ic);
+
+// Allocate a node of n terms, reusing a freed node when possible.  
+// Only nodes of 1 to 3 terms are recycled.  
+// @param ic The IC context  
+// @param n Number of terms in the node  
+// @return The starting location of the node  
+Val ic_alloc_node(IC* ic, Val n);
+
+// Return a consumed node of n terms to its free list.  
+// Does nothing unless node reuse is enabled and n is 1 to 3.  
+// @param ic The IC context  
+// @param loc The starting location of the node  
+// @param n Number of terms in the node  
+void ic_free_node(IC* ic, Val loc, Val n);
+
+// Free a discarded term and the nodes only it points to.  
+// Does nothing unless node reuse is enabled. Nodes still shared with a live  
+// variable are marked, so that the result of the reduction is unchanged.  
+// Pending terms are kept on the evaluation stack above stack_pos.  
+// @param ic The IC context  
+// @param term The discarded term  
+void ic_erase(IC* ic, Term term);
+
+// Find the cell holding the value of a duplication node, which ic_erase  
+// moves when one of the node's variables is erased.  
+// @param ic The IC context  
+// @param loc Location of the duplication node  
+// @return Location of the duplicated value  
+Val ic_dup_node(IC* ic, Val loc);
+
+// Enable the compacting collector, which runs when the heap is nearly full.  
+// @param ic The IC context  
+// @return False if the collector's space could not be reserved  
+bool ic_gc_enable(IC* ic);
+
+// Compact the heap, keeping only what is reachable from the root term and  
+// from the live entries of the evaluation stack. The space a collection  
+// needs is reserved once per context, and its pages are given back to the  
+// system after each collection.  
+// @param ic The IC context  
+// @param root The root term  
+// @return The relocated root term, or NONE (leaving the heap untouched) if  
+// the collector's space could not be reserved  
+Term ic_gc(IC* ic, Term root);
+
+// Move a freshly parsed program, and the templates of its definitions, into  
+// depth-first order, so that whnf reads nearby nodes one after another.  
+// @param ic The IC context  
+// @param root The parsed term  
+// @return The relocated root term, or NONE if memory ran out  
+Term ic_relayout(IC* ic, Term root);
+
 // Create a term with the given tag and value.  
 // @param tag The term's tag  
 // @param lab The term's label  
@@ -234,6 +580,23 @@ Term ic_make_era();
 Term ic_make_num(Val val);
 Term ic_make_suc(Val val);
 Term ic_make_swi(Val val);
+Term ic_make_op2(Val val);
+Term ic_make_ctr(Val cid, Val ari, Val val);
+Term ic_make_mat(Val len, Val val);
+Term ic_make_ref(Val id);
+
+// Check whether a term holds a heap location, which moves with its node.  
+// @param term The term to check  
+// @return True if the term's value is a location to relocate  
+bool ic_has_loc(Term term);
+
+// Check a term read from a file: the node it points to must lie below limit,  
+// and the constructor or definition it names must exist in the context.  
+// @param ic The IC context  
+// @param term The term to check  
+// @param limit End of the terms it may point into  
+// @return True if the term can be used safely  
+bool ic_term_valid(IC* ic, Term term, Val limit);
 
 // Check if a term is an erasure term.  
 // @param term The term to check  
@@ -247,6 +610,8 @@ Val ic_sup(IC* ic, Term lft, Term rgt);
 Val ic_dup(IC* ic, Term val);
 Val ic_suc(IC* ic, Term num);
 Val ic_swi(IC* ic, Term num, Term ifz, Term ifs);
+Val ic_op2(IC* ic, Oper op, Term lft, Term rgt);
+Val ic_mat(IC* ic, Term val, Val first, Val len);
 
 // Interactions
 Term ic_app_lam(IC* ic, Term app, Term lam);  
@@ -255,6 +620,7 @@ Term ic_app_era(IC* ic, Term app, Term era);
 Term ic_dup_lam(IC* ic, Term dup, Term lam);  
 Term ic_dup_sup(IC* ic, Term dup, Term sup);  
 Term ic_dup_era(IC* ic, Term dup, Term era);
+Term ic_dup_ctr(IC* ic, Term dup, Term ctr);
 
 // Numeric interactions
 Term ic_suc_num(IC* ic, Term suc, Term num);
@@ -264,6 +630,32 @@ Term ic_swi_num(IC* ic, Term swi, Term num);
 Term ic_swi_era(IC* ic, Term swi, Term era);
 Term ic_swi_sup(IC* ic, Term swi, Term sup);
 Term ic_dup_num(IC* ic, Term dup, Term num);
+Term ic_op2_num(IC* ic, Term op2, Term num);
+Term ic_op2_era(IC* ic, Term op2, Term era);
+Term ic_op2_sup(IC* ic, Term op2, Term sup);
+
+// Data type interactions
+Term ic_mat_ctr(IC* ic, Term mat, Term ctr);
+Term ic_mat_era(IC* ic, Term mat, Term era);
+Term ic_mat_sup(IC* ic, Term mat, Term sup);
+
+// Expand a reference to a top-level definition into a fresh copy.  
+// @param ic The IC context  
+// @param ref The REF term  
+// @return The copied body  
+Term ic_ref(IC* ic, Term ref);
+
+// Get the source symbol of a binary operator, such as "+" or "<=".  
+// @param op The operator  
+// @return The symbol, or "?" if op is out of range  
+const char* ic_oper_symbol(Oper op);
+
+// Apply a binary operator to two numbers.  
+// @param op The operator  
+// @param a The left operand  
+// @param b The right operand  
+// @return The result, truncated to the width of a number  
+Val ic_oper_apply(Oper op, Val a, Val b);
 
 // Reduce a term to weak head normal form (WHNF).  
 // @param ic The IC context  
@@ -271,10 +663,38 @@ Term ic_dup_num(IC* ic, Term dup, Term num);
 // @return The term in WHNF  
 Term ic_whnf(IC* ic, Term term);  
 
+// Reduce a term towards WHNF, doing at most about fuel interactions.  
+// If the fuel runs out first, the reduction is suspended: its stack stays on  
+// ic->stack and the term it was at is kept in the context, and calling again  
+// with NONE resumes it. The context must not reduce anything else meanwhile.  
+// A worker first releases the duplications it holds, so other threads can go  
+// on. The fuel is checked between interactions, so a compiled definition may  
+// go over it.  
+// @param ic The IC context  
+// @param term The term to reduce, or NONE to resume  
+// @param fuel Interactions allowed  
+// @return The term in WHNF, or NONE if suspended  
+Term ic_whnf_fuel(IC* ic, Term term, uint64_t fuel);  
+
 // Reduce a term to full normal form by recursively normalizing subterms.  
 // @param ic The IC context  
 // @param term The term to normalize  
 // @return The normalized term  
-Term ic_normal(IC* ic, Term term);  
+Term ic_normal(IC* ic, Term term);
+
+// Normalize a term, doing at most about fuel interactions.  
+// Suspends like ic_whnf_fuel, also keeping the frames of the walk on the  
+// stack; calling again with NONE resumes it.  
+// @param ic The IC context  
+// @param term The term to normalize, or NONE to resume  
+// @param fuel Interactions allowed  
+// @return The normalized term, or NONE if suspended  
+Term ic_normal_fuel(IC* ic, Term term, uint64_t fuel);  
+
+// Drop a suspended reduction, writing the state it kept on the stack back  
+// into the heap.  
+// @param ic The IC context  
+// @return The term being reduced, as far as it got (NONE if none was suspended)  
+Term ic_cancel(IC* ic);  
 
 #endif // IC_H
@@ -4,7 +4,10 @@
 #include <time.h>
 #include <sys/time.h>
 #include "ic.h"
+#include "checkpoint.h"
 #include "collapse.h"
+#include "compile.h"
+#include "parallel.h"
 #include "parse.h"
 #include "show.h"
 
@@ -29,12 +32,25 @@ static inline Term ic_normal_metal(IC* ic, Term term) {
 // Default test term string
 const char* DEFAULT_TEST_TERM = "(λf.λx.(f (f (f x))) λb.(b λt.λf.f λt.λf.t) λt.λf.t)";
 
+// Interactions between checkpoints, unless --every is given
+#define CHECKPOINT_EVERY 1000000000ULL
+
+// Limits of a normalization run in slices (see normalize_bounded)
+typedef struct {
+  uint64_t fuel;          // Interactions to stop after (0 for no limit)
+  const char* checkpoint; // File to write checkpoints to (NULL for none)
+  uint64_t every;         // Interactions between checkpoints
+} Bounds;
+
 // Function declarations
 static Term normalize_term(IC* ic, Term term, int use_gpu, int use_collapse, int thread_count);
-static void process_term(IC* ic, Term term, int use_gpu, int use_collapse, int thread_count);
+static Term normalize_bounded(IC* ic, Term term, Bounds* bounds, bool* suspended);
+static void process_term(IC* ic, Term term, int use_gpu, int use_collapse, int thread_count, Bounds* bounds);
 static void benchmark_term(IC* ic, Term term, int use_gpu, int use_collapse, int thread_count);
+static void enumerate_term(IC* ic, Term term, ICEnumOrder order, Val limit);
 static void test(IC* ic, int use_gpu, int use_collapse, int thread_count);
 static void print_usage(void);
+static int parse_size(const char* str, Val auto_size, Val* size);
 
 // Normalize a term based on mode flags
 static Term normalize_term(IC* ic, Term term, int use_gpu, int use_collapse, int thread_count) {
@@ -48,9 +64,7 @@ static Term normalize_term(IC* ic, Term term, int use_gpu, int use_collapse, int
         return ic_normal(ic, term);
       }
     } else {
-      term = ic_collapse_sups(ic, term);
-      term = ic_collapse_dups(ic, term);
-      return term;
+      return ic_collapse_par(ic, term, thread_count);
     }
   } else {
     if (use_gpu) {
@@ -61,29 +75,78 @@ static Term normalize_term(IC* ic, Term term, int use_gpu, int use_collapse, int
         return ic_normal(ic, term);
       }
     } else {
-      return ic_normal(ic, term);
+      return ic_normal_par(ic, term, thread_count);
+    }
+  }
+}
+
+// Normalize a term in slices, writing a checkpoint after each one, until
+// it is normal or the fuel is spent. A checkpoint is skipped while the last
+// one is still being written. If the fuel runs out, a last checkpoint is
+// written before the reduction is dropped.
+// @param term The term to normalize, or NONE to resume a loaded checkpoint
+// @param suspended Set if the fuel ran out first
+// @return The normalized term, or the term as far as it got
+static Term normalize_bounded(IC* ic, Term term, Bounds* bounds, bool* suspended) {
+  uint64_t end = bounds->fuel > 0 ? ic->interactions + bounds->fuel : UINT64_MAX;
+  pid_t writer = -1;
+  while (1) {
+    uint64_t slice = end - ic->interactions;
+    if (bounds->checkpoint && bounds->every < slice) {
+      slice = bounds->every;
+    }
+    term = ic_normal_fuel(ic, term, slice);
+    if (term != NONE || ic->interactions >= end) {
+      break;
+    }
+    if (writer < 0 || ic_checkpoint_wait(writer, false) != 1) {
+      writer = ic_checkpoint_fork(ic, bounds->checkpoint);
     }
   }
+  if (writer >= 0) {
+    ic_checkpoint_wait(writer, true);
+  }
+
+  *suspended = term == NONE;
+  if (*suspended) {
+    if (bounds->checkpoint) {
+      ic_checkpoint_save(ic, bounds->checkpoint);
+    }
+    term = ic_cancel(ic);
+  }
+  return term;
 }
 
 // Process and print results of term normalization
-static void process_term(IC* ic, Term term, int use_gpu, int use_collapse, int thread_count) {
-  ic->interactions = 0; // Reset interaction counter
+// With bounds, normalization runs in slices (see normalize_bounded). A NONE
+// term resumes a loaded checkpoint, counting its interactions on.
+static void process_term(IC* ic, Term term, int use_gpu, int use_collapse, int thread_count, Bounds* bounds) {
+  if (term != NONE) {
+    ic->interactions = 0; // Reset interaction counter
+  }
 
   struct timeval start_time, current_time;
   gettimeofday(&start_time, NULL);
 
-  term = normalize_term(ic, term, use_gpu, use_collapse, thread_count);
+  bool suspended = false;
+  if (bounds->fuel > 0 || bounds->checkpoint || term == NONE) {
+    term = normalize_bounded(ic, term, bounds, &suspended);
+  } else {
+    term = normalize_term(ic, term, use_gpu, use_collapse, thread_count);
+  }
 
   gettimeofday(&current_time, NULL);
   double elapsed_seconds = (current_time.tv_sec - start_time.tv_sec) +
                            (current_time.tv_usec - start_time.tv_usec) / 1000000.0;
 
-  size_t size = ic->heap_pos; // Heap size in nodes
+  size_t size = ic_heap_used(ic); // Heap size in nodes
   double perf = elapsed_seconds > 0 ? (ic->interactions / elapsed_seconds) / 1000000.0 : 0.0;
 
-  // Use namespaced version with '$' prefix when collapse mode is off
-  if (use_collapse) {
+  // Use namespaced version with '$' prefix when collapse mode is off.
+  // A partial term left in a checkpoint is not printed, as it can be huge.
+  if (suspended && bounds->checkpoint) {
+    printf("(suspended)");
+  } else if (use_collapse) {
     show_term(stdout, ic, term);
   } else {
     show_term_namespaced(stdout, ic, term, "$");
@@ -107,22 +170,27 @@ static void process_term(IC* ic, Term term, int use_gpu, int use_collapse, int t
     mode_str = "CPU";
   }
   printf("MODE: %s\n", mode_str);
+  if (ic->pages != IC_PAGES_SMALL) {
+    printf("PAGE: heap on %s, stack on %s\n", ic_pages_name(ic->heap_pages), ic_pages_name(ic->stack_pages));
+  }
   if (use_gpu && use_collapse) {
     printf("Note: Collapse mode is not available for GPU. Used normal GPU normalization.\n");
   }
+  if (suspended && bounds->checkpoint) {
+    printf("Note: Out of fuel. Run `ic resume %s` to go on.\n", bounds->checkpoint);
+  } else if (suspended) {
+    printf("Note: Out of fuel. The term above is only partly normalized.\n");
+  }
   printf("\n");
 }
 
 // Benchmark normalization performance over 1 second
 static void benchmark_term(IC* ic, Term term, int use_gpu, int use_collapse, int thread_count) {
   // Snapshot initial heap state
-  Val original_heap_pos = ic->heap_pos;
-  Term* original_heap_state = (Term*)malloc(original_heap_pos * sizeof(Term));
-  if (!original_heap_state) {
+  if (!ic_snapshot(ic)) {
     fprintf(stderr, "Error: Memory allocation failed for heap snapshot\n");
     return;
   }
-  memcpy(original_heap_state, ic->heap, original_heap_pos * sizeof(Term));
   Term original_term = term;
 
   // Normalize once to show result
@@ -143,8 +211,7 @@ static void benchmark_term(IC* ic, Term term, int use_gpu, int use_collapse, int
   double elapsed_seconds = 0;
 
   while (elapsed_seconds < 1.0) {
-    ic->heap_pos = original_heap_pos;
-    memcpy(ic->heap, original_heap_state, original_heap_pos * sizeof(Term));
+    ic_restore(ic);
     ic->interactions = 0;
 
     normalize_term(ic, original_term, use_gpu, use_collapse, thread_count);
@@ -178,18 +245,58 @@ static void benchmark_term(IC* ic, Term term, int use_gpu, int use_collapse, int
     mode_str = "CPU";
   }
   printf("- MODE: %s\n", mode_str);
+  if (ic->pages != IC_PAGES_SMALL) {
+    printf("- PAGE: heap on %s, stack on %s\n", ic_pages_name(ic->heap_pages), ic_pages_name(ic->stack_pages));
+  }
   if (use_gpu && use_collapse) {
     printf("- Note: Collapse mode is not available for GPU. Used normal GPU normalization.\n");
   }
 
-  free(original_heap_state);
+  ic_snapshot_free(ic);
+}
+
+// Print a result of the enumeration as soon as it is found.
+// @param ctx The stream to print to
+static bool enumerate_emit(IC* ic, Term term, void* ctx) {
+  FILE* out = (FILE*)ctx;
+  show_term(out, ic, term);
+  fprintf(out, "\n");
+  fflush(out);
+  return true;
+}
+
+// Enumerate and print the collapsed results of a term
+static void enumerate_term(IC* ic, Term term, ICEnumOrder order, Val limit) {
+  ic->interactions = 0; // Reset interaction counter
+
+  struct timeval start_time, current_time;
+  gettimeofday(&start_time, NULL);
+
+  Val count = ic_collapse_enum(ic, term, order, limit, enumerate_emit, stdout);
+
+  gettimeofday(&current_time, NULL);
+  double elapsed_seconds = (current_time.tv_sec - start_time.tv_sec) +
+                           (current_time.tv_usec - start_time.tv_usec) / 1000000.0;
+
+  size_t size = ic_heap_used(ic); // Heap size in nodes
+  double perf = elapsed_seconds > 0 ? (ic->interactions / elapsed_seconds) / 1000000.0 : 0.0;
+
+  printf("\n");
+  printf("ENUM: %llu results\n", (unsigned long long)count);
+  printf("WORK: %llu interactions\n", (unsigned long long)ic->interactions);
+  printf("TIME: %.7f seconds\n", elapsed_seconds);
+  printf("SIZE: %zu nodes\n", size);
+  printf("PERF: %.3f MIPS\n", perf);
+  printf("MODE: CPU (enum, %s)\n", order == IC_ENUM_BFS ? "bfs" : "dfs");
+  printf("\n");
 }
 
 // Run default test term
 static void test(IC* ic, int use_gpu, int use_collapse, int thread_count) {
   printf("Running with default test term: %s\n", DEFAULT_TEST_TERM);
   Term term = parse_string(ic, DEFAULT_TEST_TERM);
-  process_term(ic, term, use_gpu, use_collapse, thread_count);
+  Bounds bounds = {0, NULL, 0};
+  process_term(ic, term, use_gpu, use_collapse, thread_count, &bounds);
 }
 
 // Print command-line usage
@@ -202,71 +309,293 @@ static void print_usage(void) {
   printf("  eval-gpu <expr>  - Parse and normalize a IC expression on GPU (Metal)\n");
   printf("  bench <file>     - Benchmark normalization of a IC file on CPU\n");
   printf("  bench-gpu <file> - Benchmark normalization of a IC file on GPU (Metal)\n");
+  printf("  compile <file>   - Compile the definitions of a IC file to C (64-bit build)\n");
+  printf("  build <file>     - Parse a IC file into a binary image that run, bench and enum load\n");
+  printf("  enum <file>      - Print the collapsed results of a IC file one at a time\n");
+  printf("  resume <file>    - Resume a normalization from a checkpoint file\n");
   printf("\n");
   printf("Options:\n");
   printf("  -C             - Use collapse mode (CPU only)\n");
+  printf("  -R             - Reuse consumed and discarded nodes (free-list allocator)\n");
+  printf("  -G             - Compact the heap when it fills up (not in collapse mode)\n");
+  printf("  -L             - Lay out the parsed program in depth-first order\n");
+  printf("  -T <threads>   - Normalize or collapse with this many threads\n");
+  printf("  --heap <size>  - Heap size in terms (e.g. 64M, or 'auto' to fit available memory)\n");
+  printf("  --stack <size> - Stack size in terms (e.g. 16M, or 'auto' to fit available memory)\n");
+  printf("  --huge <pages> - Back heap and stack with huge pages: 2M, 1G or thp (transparent)\n");
+  printf("  -o <file>      - Output file for compile (default: stdout) or build\n");
+  printf("  --limit <n>    - Stop enum after this many results\n");
+  printf("  --order <o>    - Order of enum: dfs (depth first, default) or bfs\n");
+  printf("  --fuel <n>     - Stop after about n interactions (run, eval, resume; CPU, one thread)\n");
+  printf("  --checkpoint <f> - Write the state of the reduction to this file now and then\n");
+  printf("  --every <n>    - Interactions between checkpoints (default: 1G)\n");
   printf("\n");
 }
 
-int main(int argc, char* argv[]) {
-  IC* ic = ic_default_new();
-  if (!ic) {
-    fprintf(stderr, "Error: Failed to initialize IC context\n");
-    return 1;
+// Parse a size in terms, with an optional K/M/G suffix, or "auto".
+// @param str The size string
+// @param auto_size The size to use for "auto"
+// @param size Where to store the parsed size
+// @return 0 on success, -1 if the size is invalid
+static int parse_size(const char* str, Val auto_size, Val* size) {
+  if (strcmp(str, "auto") == 0) {
+    *size = auto_size;
+    return 0;
   }
+  char* end;
+  unsigned long long n = strtoull(str, &end, 10);
+  if (end == str) return -1;
+  switch (*end) {
+    case 'K': case 'k': n <<= 10; end++; break;
+    case 'M': case 'm': n <<= 20; end++; break;
+    case 'G': case 'g': n <<= 30; end++; break;
+  }
+  if (*end != '\0' || n == 0) return -1;
+  *size = n > IC_MAX_HEAP_SIZE ? IC_MAX_HEAP_SIZE : (Val)n;
+  return 0;
+}
 
+int main(int argc, char* argv[]) {
+  IC* ic = NULL;
   int result = 0;
   int use_gpu = 0;
   int use_collapse = 0;
+  int use_reuse = 0;
+  int use_gc = 0;
+  int use_layout = 0;
   int thread_count = 1;
+  Val heap_size = IC_DEFAULT_HEAP_SIZE;
+  Val stack_size = IC_DEFAULT_STACK_SIZE;
+  ICPages pages = IC_PAGES_SMALL;
+  const char* output = NULL;
+  ICEnumOrder order = IC_ENUM_DFS;
+  Val limit = 0;
+  Bounds bounds = {0, NULL, CHECKPOINT_EVERY};
+
+  const char* command = argc >= 2 ? argv[1] : NULL;
+  if (command) {
+    if (strcmp(command, "run-gpu") == 0 || strcmp(command, "eval-gpu") == 0 || strcmp(command, "bench-gpu") == 0) {
+      use_gpu = 1;
+    } else if (strcmp(command, "enum") == 0) {
+      use_collapse = 1; // Enumerates the results of the collapse
+    } else if (strcmp(command, "run") != 0 && strcmp(command, "eval") != 0 && strcmp(command, "bench") != 0 &&
+               strcmp(command, "compile") != 0 && strcmp(command, "build") != 0 && strcmp(command, "enum") != 0 && strcmp(command, "resume") != 0) {
+      fprintf(stderr, "Error: Unknown command '%s'\n", command);
+      print_usage();
+      return 1;
+    }
 
-  if (argc < 2) {
-    test(ic, 0, 0, thread_count);
-    goto cleanup;
+    if (argc < 3) {
+      fprintf(stderr, "Error: No term source specified\n");
+      print_usage();
+      return 1;
+    }
   }
 
-  const char* command = argv[1];
-  if (strcmp(command, "run-gpu") == 0 || strcmp(command, "eval-gpu") == 0 || strcmp(command, "bench-gpu") == 0) {
-    use_gpu = 1;
-  } else if (strcmp(command, "run") != 0 && strcmp(command, "eval") != 0 && strcmp(command, "bench") != 0) {
-    fprintf(stderr, "Error: Unknown command '%s'\n", command);
-    print_usage();
-    result = 1;
-    goto cleanup;
-  }
+  // "auto" sizes take half of the available memory for the heap and an
+  // eighth of that for the stack; pages are only committed when touched
+  uint64_t mem = ic_available_memory();
+  Val auto_heap = mem / 2 / sizeof(Term);
+  if (auto_heap == 0) auto_heap = IC_DEFAULT_HEAP_SIZE;
+  if (auto_heap > IC_MAX_HEAP_SIZE) auto_heap = IC_MAX_HEAP_SIZE;
+  Val auto_stack = auto_heap / 8;
 
-  if (argc < 3) {
-    fprintf(stderr, "Error: No term source specified\n");
-    print_usage();
-    result = 1;
-    goto cleanup;
-  }
+  // Commands that can run in slices (see normalize_bounded)
+  bool bounded = command && (strcmp(command, "run") == 0 || strcmp(command, "eval") == 0 || strcmp(command, "resume") == 0);
 
   // Parse flags
   for (int i = 3; i < argc; i++) {
     if (strcmp(argv[i], "-C") == 0) {
       use_collapse = 1;
+    } else if (strcmp(argv[i], "-R") == 0) {
+      use_reuse = 1;
+    } else if (strcmp(argv[i], "-G") == 0) {
+      use_gc = 1;
+    } else if (strcmp(argv[i], "-L") == 0) {
+      use_layout = 1;
+    } else if (strcmp(argv[i], "-T") == 0) {
+      thread_count = i + 1 < argc ? atoi(argv[i + 1]) : 0;
+      if (thread_count < 1) {
+        fprintf(stderr, "Error: Invalid thread count for '-T'\n");
+        print_usage();
+        return 1;
+      }
+      i++;
+    } else if (strcmp(argv[i], "--heap") == 0 || strcmp(argv[i], "--stack") == 0) {
+      int is_heap = argv[i][2] == 'h';
+      if (i + 1 >= argc || parse_size(argv[i + 1], is_heap ? auto_heap : auto_stack, is_heap ? &heap_size : &stack_size) != 0) {
+        fprintf(stderr, "Error: Invalid size for '%s'\n", argv[i]);
+        print_usage();
+        return 1;
+      }
+      i++;
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc && (strcmp(command, "compile") == 0 || strcmp(command, "build") == 0)) {
+      output = argv[++i];
+    } else if (strcmp(argv[i], "--limit") == 0 && strcmp(command, "enum") == 0) {
+      char* end = NULL;
+      limit = i + 1 < argc ? strtoull(argv[i + 1], &end, 10) : 0;
+      if (limit == 0 || *end != '\0') {
+        fprintf(stderr, "Error: Invalid count for '--limit'\n");
+        print_usage();
+        return 1;
+      }
+      i++;
+    } else if (strcmp(argv[i], "--order") == 0 && strcmp(command, "enum") == 0) {
+      const char* kind = i + 1 < argc ? argv[i + 1] : "";
+      if (strcmp(kind, "dfs") == 0) {
+        order = IC_ENUM_DFS;
+      } else if (strcmp(kind, "bfs") == 0) {
+        order = IC_ENUM_BFS;
+      } else {
+        fprintf(stderr, "Error: Invalid order for '--order'\n");
+        print_usage();
+        return 1;
+      }
+      i++;
+    } else if ((strcmp(argv[i], "--fuel") == 0 || strcmp(argv[i], "--every") == 0) && bounded) {
+      char* end = NULL;
+      uint64_t n = i + 1 < argc ? strtoull(argv[i + 1], &end, 10) : 0;
+      if (n == 0 || *end != '\0') {
+        fprintf(stderr, "Error: Invalid count for '%s'\n", argv[i]);
+        print_usage();
+        return 1;
+      }
+      if (argv[i][2] == 'f') {
+        bounds.fuel = n;
+      } else {
+        bounds.every = n;
+      }
+      i++;
+    } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc && bounded) {
+      bounds.checkpoint = argv[++i];
+    } else if (strcmp(argv[i], "--huge") == 0) {
+      const char* kind = i + 1 < argc ? argv[i + 1] : "";
+      if (strcmp(kind, "2M") == 0) {
+        pages = IC_PAGES_2M;
+      } else if (strcmp(kind, "1G") == 0) {
+        pages = IC_PAGES_1G;
+      } else if (strcmp(kind, "thp") == 0) {
+        pages = IC_PAGES_THP;
+      } else {
+        fprintf(stderr, "Error: Invalid page size for '--huge'\n");
+        print_usage();
+        return 1;
+      }
+      i++;
     } else {
       fprintf(stderr, "Error: Unknown flag '%s'\n", argv[i]);
       print_usage();
+      return 1;
+    }
+  }
+
+  ic = ic_new(heap_size, stack_size, pages);
+  if (!ic) {
+    fprintf(stderr, "Error: Failed to initialize IC context\n");
+    return 1;
+  }
+  ic->reuse = use_reuse;
+
+  if (!command) {
+    test(ic, 0, 0, thread_count);
+    goto cleanup;
+  }
+
+  if (strcmp(command, "compile") == 0) {
+    FILE* out = output ? fopen(output, "w") : stdout;
+    if (!out) {
+      fprintf(stderr, "Error: Could not open file '%s'\n", output);
       result = 1;
       goto cleanup;
     }
+    result = compile_file(out, ic, argv[2]) == 0 ? 0 : 1;
+    if (output) {
+      fclose(out);
+    }
+    goto cleanup;
+  }
+
+  if (strcmp(command, "build") == 0) {
+    if (!output) {
+      fprintf(stderr, "Error: No output file specified for 'build' (use '-o')\n");
+      result = 1;
+      goto cleanup;
+    }
+    Term term = parse_file(ic, argv[2]);
+    if (term == NONE) {
+      result = 1;
+      goto cleanup;
+    }
+    if (use_layout && (term = ic_relayout(ic, term)) == NONE) {
+      result = 1;
+      goto cleanup;
+    }
+    result = ic_image_save(ic, term, output) == 0 ? 0 : 1;
+    goto cleanup;
+  }
+
+  if ((bounds.fuel > 0 || bounds.checkpoint) && (use_collapse || thread_count > 1)) {
+    fprintf(stderr, "Error: '--fuel' and '--checkpoint' need a single thread and no collapse mode\n");
+    result = 1;
+    goto cleanup;
+  }
+
+  if (thread_count > 1 && strcmp(command, "enum") == 0) {
+    fprintf(stderr, "Warning: Enumeration runs on a single thread.\n");
+  }
+
+  // The collapser keeps terms on the C stack, and workers don't stop for a
+  // collection, so neither can be collected
+  if (use_gc) {
+    if (use_collapse) {
+      fprintf(stderr, "Warning: Garbage collection is not available in collapse mode.\n");
+    } else if (thread_count > 1) {
+      fprintf(stderr, "Warning: Garbage collection is not available with multiple threads.\n");
+    } else {
+      if (!ic_gc_enable(ic)) {
+        fprintf(stderr, "Warning: Garbage collection is not available.\n");
+      }
+    }
   }
 
   // Parse term based on command
   Term term;
-  if (strcmp(command, "eval") == 0 || strcmp(command, "eval-gpu") == 0) {
-    term = parse_string(ic, argv[2]);
-  } else { // run, run-gpu, bench, bench-gpu
-    term = parse_file(ic, argv[2]);
+  if (strcmp(command, "resume") == 0) {
+    if (use_collapse || thread_count > 1) {
+      fprintf(stderr, "Error: Resume needs a single thread and no collapse mode\n");
+      result = 1;
+      goto cleanup;
+    }
+    if (ic_checkpoint_load(ic, argv[2]) != 0) {
+      result = 1;
+      goto cleanup;
+    }
+    term = NONE; // Resumes the loaded reduction
+  } else {
+    if (strcmp(command, "eval") == 0 || strcmp(command, "eval-gpu") == 0) {
+      term = parse_string(ic, argv[2]);
+    } else if (ic_image_is(argv[2])) { // Built with 'build'
+      term = ic_image_load(ic, argv[2]);
+    } else { // run, run-gpu, bench, bench-gpu, enum
+      term = parse_file(ic, argv[2]);
+    }
+    if (term == NONE) {
+      result = 1;
+      goto cleanup;
+    }
+  }
+  if (use_layout && term != NONE && (term = ic_relayout(ic, term)) == NONE) {
+    result = 1;
+    goto cleanup;
   }
 
   // Execute command
   if (strcmp(command, "bench") == 0 || strcmp(command, "bench-gpu") == 0) {
     benchmark_term(ic, term, use_gpu, use_collapse, thread_count);
-  } else { // run, run-gpu, eval, eval-gpu
-    process_term(ic, term, use_gpu, use_collapse, thread_count);
+  } else if (strcmp(command, "enum") == 0) {
+    enumerate_term(ic, term, order, limit);
+  } else { // run, run-gpu, eval, eval-gpu, resume
+    process_term(ic, term, use_gpu, use_collapse, thread_count, &bounds);
   }
 
 cleanup:
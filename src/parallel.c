@@ -0,0 +1,287 @@
+//./ic.h//
+//./parallel.h//
+
+#define _DEFAULT_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include "ic.h"
+#include "parallel.h"
+
+// Capacity of each worker's deque (a power of two). A worker whose deque is
+// full normalizes the extra fields itself instead of publishing them.
+#define DEQUE_SIZE (1 << 16)
+
+// -----------------------------------------------------------------------------
+// Work-Stealing Deque
+// -----------------------------------------------------------------------------
+
+// Chase-Lev deque of heap locations. The owner pushes and pops at the bottom;
+// other threads steal from the top.
+typedef struct {
+  Val* buf;
+  int64_t top;
+  int64_t bottom;
+} Deque;
+
+// Push a task. Only called by the owner.
+// @return False if the deque is full
+static bool deque_push(Deque* dq, Val loc) {
+  int64_t b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED);
+  int64_t t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+  if (b - t >= DEQUE_SIZE) {
+    return false;
+  }
+  __atomic_store_n(&dq->buf[b & (DEQUE_SIZE - 1)], loc, __ATOMIC_RELAXED);
+  __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+// Pop the most recently pushed task. Only called by the owner.
+// @return False if the deque is empty or the last task was stolen
+static bool deque_pop(Deque* dq, Val* loc) {
+  int64_t b = __atomic_load_n(&dq->bottom, __ATOMIC_RELAXED) - 1;
+  __atomic_store_n(&dq->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t t = __atomic_load_n(&dq->top, __ATOMIC_RELAXED);
+  if (t > b) {
+    __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    return false;
+  }
+  *loc = __atomic_load_n(&dq->buf[b & (DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+  if (t == b) {
+    // Last task: race against thieves for it
+    bool won = __atomic_compare_exchange_n(&dq->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&dq->bottom, b + 1, __ATOMIC_RELAXED);
+    return won;
+  }
+  return true;
+}
+
+// Steal the oldest task. Called by other threads.
+// @return False if the deque is empty or another thread won the race
+static bool deque_steal(Deque* dq, Val* loc) {
+  int64_t t = __atomic_load_n(&dq->top, __ATOMIC_ACQUIRE);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  int64_t b = __atomic_load_n(&dq->bottom, __ATOMIC_ACQUIRE);
+  if (t >= b) {
+    return false;
+  }
+  *loc = __atomic_load_n(&dq->buf[t & (DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+  return __atomic_compare_exchange_n(&dq->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+// -----------------------------------------------------------------------------
+// Workers
+// -----------------------------------------------------------------------------
+
+typedef struct Worker Worker;
+
+// State shared by all workers of one normalization.
+typedef struct {
+  Worker* workers;
+  int count;
+  int64_t pending; // Tasks pushed but not finished yet
+} Pool;
+
+struct Worker {
+  IC* ic;
+  Deque deque;
+  Pool* pool;
+  int id;
+  uint32_t seed; // Random state for picking victims
+};
+
+// Normalize the term stored at a heap location, in place. The fields of each
+// WHNF are pushed as tasks, except the first one, which this worker continues
+// with directly.
+static void worker_normalize(Worker* w, Val loc) {
+  IC* ic = w->ic;
+  Term* heap = ic->heap;
+  while (1) {
+    Term term = ic_whnf(ic, heap[loc]);
+    heap[loc] = term;
+
+    TermTag tag = TERM_TAG(term);
+    Val ari;
+    if (tag == LAM || tag == SUC) {
+      ari = 1;
+    } else if (tag == APP || IS_SUP(tag) || tag == OP2) {
+      ari = 2;
+    } else if (tag == SWI) {
+      ari = 3;
+    } else if (IS_CTR(tag) && CTR_ARI(term) > 0) {
+      ari = CTR_ARI(term);
+    } else if (IS_MAT(tag)) {
+      ari = MAT_LEN(term) + 2;
+    } else {
+      return;
+    }
+
+    Val node = TERM_VAL(term);
+    for (Val i = ari - 1; i > 0; i--) {
+      __atomic_fetch_add(&w->pool->pending, 1, __ATOMIC_RELAXED);
+      if (!deque_push(&w->deque, node + i)) {
+        __atomic_fetch_sub(&w->pool->pending, 1, __ATOMIC_RELAXED);
+        worker_normalize(w, node + i);
+      }
+    }
+    loc = node;
+  }
+}
+
+// Find a task: pop our own deque, or steal from a random other worker.
+static bool worker_find(Worker* w, Val* loc) {
+  if (deque_pop(&w->deque, loc)) {
+    return true;
+  }
+  Pool* pool = w->pool;
+  for (int i = 0; i < pool->count; i++) {
+    w->seed = w->seed * 1103515245 + 12345;
+    int victim = (w->seed >> 16) % pool->count;
+    if (victim != w->id && deque_steal(&pool->workers[victim].deque, loc)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Run tasks until every pushed task has been finished.
+static void* worker_main(void* arg) {
+  Worker* w = (Worker*)arg;
+  Pool* pool = w->pool;
+  void* alt = ic_guard_thread_start();
+  Val loc;
+  while (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) > 0) {
+    if (worker_find(w, &loc)) {
+      worker_normalize(w, loc);
+      __atomic_fetch_sub(&pool->pending, 1, __ATOMIC_RELEASE);
+    } else {
+      sched_yield();
+    }
+  }
+  ic_guard_thread_stop(alt);
+  return NULL;
+}
+
+// -----------------------------------------------------------------------------
+// Parallel Normalization
+// -----------------------------------------------------------------------------
+
+Term ic_normal_par(IC* ic, Term term, int threads) {
+  if (threads <= 1) {
+    return ic_normal(ic, term);
+  }
+
+  Pool pool;
+  pool.count = threads;
+  pool.pending = 0;
+  pool.workers = (Worker*)calloc(threads, sizeof(Worker));
+  if (!pool.workers) {
+    fprintf(stderr, "Error: Failed to allocate worker threads\n");
+    exit(1);
+  }
+  for (int i = 0; i < threads; i++) {
+    Worker* w = &pool.workers[i];
+    w->ic = ic_worker_new(ic);
+    w->deque.buf = (Val*)malloc(DEQUE_SIZE * sizeof(Val));
+    if (!w->ic || !w->deque.buf) {
+      fprintf(stderr, "Error: Failed to allocate worker threads\n");
+      exit(1);
+    }
+    w->pool = &pool;
+    w->id = i;
+    w->seed = i + 1;
+  }
+
+  // The root is normalized in place, like every other field
+  Val root = ic_alloc(ic, 1);
+  ic->heap[root] = term;
+  pool.pending = 1;
+  deque_push(&pool.workers[0].deque, root);
+
+  // The calling thread acts as worker 0
+  pthread_t* tids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+  for (int i = 1; i < threads; i++) {
+    pthread_create(&tids[i], NULL, worker_main, &pool.workers[i]);
+  }
+  worker_main(&pool.workers[0]);
+  for (int i = 1; i < threads; i++) {
+    pthread_join(tids[i], NULL);
+  }
+  free(tids);
+
+  for (int i = 0; i < threads; i++) {
+    ic->interactions += pool.workers[i].ic->interactions;
+    ic_free(pool.workers[i].ic);
+    free(pool.workers[i].deque.buf);
+  }
+  free(pool.workers);
+
+  return ic->heap[root];
+}
+
+// -----------------------------------------------------------------------------
+// Parallel Loops
+// -----------------------------------------------------------------------------
+
+// State shared by the threads of ic_parallel_for.
+typedef struct {
+  Val next;  // Index of the next task to take
+  Val count; // Number of tasks
+  void (*fn)(IC* ic, Val i, void* ctx);
+  void* ctx;
+} Loop;
+
+typedef struct {
+  IC* ic;
+  Loop* loop;
+} LoopWorker;
+
+// Take tasks until there are none left.
+static void* loop_main(void* arg) {
+  LoopWorker* w = (LoopWorker*)arg;
+  Loop* loop = w->loop;
+  void* alt = ic_guard_thread_start();
+  while (1) {
+    Val i = __atomic_fetch_add(&loop->next, 1, __ATOMIC_RELAXED);
+    if (i >= loop->count) {
+      ic_guard_thread_stop(alt);
+      return NULL;
+    }
+    loop->fn(w->ic, i, loop->ctx);
+  }
+}
+
+void ic_parallel_for(IC* ic, int threads, Val count, void (*fn)(IC* ic, Val i, void* ctx), void* ctx) {
+  Loop loop = {0, count, fn, ctx};
+  LoopWorker* workers = (LoopWorker*)calloc(threads, sizeof(LoopWorker));
+  pthread_t* tids = (pthread_t*)malloc(threads * sizeof(pthread_t));
+  if (!workers || !tids) {
+    fprintf(stderr, "Error: Failed to allocate worker threads\n");
+    exit(1);
+  }
+  for (int i = 0; i < threads; i++) {
+    workers[i].ic = ic_worker_new(ic);
+    workers[i].loop = &loop;
+    if (!workers[i].ic) {
+      fprintf(stderr, "Error: Failed to allocate worker threads\n");
+      exit(1);
+    }
+  }
+
+  // The calling thread acts as worker 0
+  for (int i = 1; i < threads; i++) {
+    pthread_create(&tids[i], NULL, loop_main, &workers[i]);
+  }
+  loop_main(&workers[0]);
+  for (int i = 1; i < threads; i++) {
+    pthread_join(tids[i], NULL);
+  }
+  free(tids);
+
+  for (int i = 0; i < threads; i++) {
+    ic->interactions += workers[i].ic->interactions;
+    ic_free(workers[i].ic);
+  }
+  free(workers);
+}
@@ -0,0 +1,28 @@
+//./parallel.c//
+
+#ifndef IC_PARALLEL_H
+#define IC_PARALLEL_H
+
+#include "ic.h"
+
+// Reduce a term to full normal form using several threads.
+// Each thread owns a work-stealing deque of heap locations whose terms still
+// have to be normalized; the fields of a term in WHNF are pushed as tasks, and
+// idle threads steal from the others. Garbage collection must be disabled.
+// @param ic The IC context
+// @param term The term to normalize
+// @param threads Number of threads (1 uses ic_normal)
+// @return The normalized term
+Term ic_normal_par(IC* ic, Term term, int threads);
+
+// Run a function on a list of tasks using several threads. Each thread has a
+// worker context (see ic_worker_new), and takes the next task when it is
+// done with the previous one.
+// @param ic The IC context
+// @param threads Number of threads
+// @param count Number of tasks
+// @param fn Called with the thread's worker context and the index of a task
+// @param ctx Passed on to fn
+void ic_parallel_for(IC* ic, int threads, Val count, void (*fn)(IC* ic, Val i, void* ctx), void* ctx);
+
+#endif // IC_PARALLEL_H
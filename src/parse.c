@@ -15,53 +15,173 @@ bool peek_is(Parser* parser, char c);
 void parse_error(Parser* parser, const char* message);
 
 // Helper functions
-static bool starts_with_dollar(const char* name) {
-  return name[0] == '$';
+static bool starts_with_dollar(Name name) {
+  return name.str[0] == '$';
 }
 
-static size_t find_or_add_global_var(Parser* parser, const char* name) {
-  for (size_t i = 0; i < parser->global_vars_count; i++) {
-    if (strcmp(parser->global_vars[i].name, name) == 0) {
-      return i;
+// Note a variable bound at a location. Global variables can be used outside
+// of the lambda that binds them, so they keep every enclosing lambda open.
+static void note_binder(Parser* parser, Val loc) {
+  if (loc < parser->lam_min_binder) {
+    parser->lam_min_binder = loc;
+  }
+}
+
+// Note the term an eliminator or duplication acts on. Unless it is stuck on
+// a variable, this is a redex, and copying the lambda around it would copy
+// the work of reducing it too.
+static void note_head(Parser* parser, Term head) {
+  TermTag tag = TERM_TAG(head);
+  bool stuck = tag == VAR || IS_DUP(tag) || tag == APP || tag == SUC || tag == SWI || IS_OP2(tag) || IS_MAT(tag);
+  if (!stuck) {
+    parser->lam_has_redex = true;
+  }
+}
+
+static uint64_t hash_name(Name name) {
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < name.len; i++) {
+    hash = (hash ^ (uint8_t)name.str[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static bool name_is(Name name, const char* str) {
+  return strncmp(name.str, str, name.len) == 0 && str[name.len] == '\0';
+}
+
+// Copy a name to the parser's scratch buffer, to pass it to the context.
+// @return The name as a string, valid until the next call
+static const char* name_text(Parser* parser, Name name) {
+  if (name.len + 1 > parser->text_cap) {
+    size_t cap = name.len + 1 > 64 ? name.len + 1 : 64;
+    char* text = (char*)realloc(parser->text, cap);
+    if (!text) {
+      parse_error(parser, "Memory allocation failed");
     }
+    parser->text = text;
+    parser->text_cap = cap;
   }
-  if (parser->global_vars_count >= MAX_GLOBAL_VARS) {
-    parse_error(parser, "Too many global variables");
+  memcpy(parser->text, name.str, name.len);
+  parser->text[name.len] = '\0';
+  return parser->text;
+}
+
+// Copy a name to a new string.
+// @return The string, or NULL if it could not be allocated
+static char* name_dup(Name name) {
+  char* str = (char*)malloc(name.len + 1);
+  if (str) {
+    memcpy(str, name.str, name.len);
+    str[name.len] = '\0';
   }
-  size_t idx = parser->global_vars_count++;
-  Binder* binder = &parser->global_vars[idx];
-  strncpy(binder->name, name, MAX_NAME_LEN - 1);
-  binder->name[MAX_NAME_LEN - 1] = '\0';
-  binder->var = NONE;
-  binder->loc = NONE;
-  return idx;
+  return str;
+}
+
+// Grow an array of binders to hold one more.
+static void grow_binders(Parser* parser, Binder** binders, size_t count, size_t* cap) {
+  if (count < *cap) {
+    return;
+  }
+  size_t new_cap = *cap ? *cap * 2 : 64;
+  Binder* grown = (Binder*)realloc(*binders, new_cap * sizeof(Binder));
+  if (!grown) {
+    parse_error(parser, "Memory allocation failed");
+  }
+  *binders = grown;
+  *cap = new_cap;
 }
 
-static void push_lexical_binder(Parser* parser, const char* name, Term term) {
-  if (parser->lexical_vars_count >= MAX_LEXICAL_VARS) {
-    parse_error(parser, "Too many lexical binders");
+static NameSlot* probe_name(NameSlot* names, size_t size, Name name) {
+  size_t mask = size - 1;
+  size_t i = hash_name(name) & mask;
+  while (names[i].name.str &&
+         (names[i].name.len != name.len || memcmp(names[i].name.str, name.str, name.len) != 0)) {
+    i = (i + 1) & mask;
   }
+  return &names[i];
+}
+
+// Find the slot of a name in the name table, adding the name if missing.
+static NameSlot* find_name(Parser* parser, Name name) {
+  if ((parser->names_count + 1) * 2 > parser->names_size) {
+    size_t size = parser->names_size ? parser->names_size * 2 : 256;
+    NameSlot* names = (NameSlot*)calloc(size, sizeof(NameSlot));
+    if (!names) {
+      parse_error(parser, "Memory allocation failed");
+    }
+    for (size_t i = 0; i < parser->names_size; i++) {
+      if (parser->names[i].name.str) {
+        *probe_name(names, size, parser->names[i].name) = parser->names[i];
+      }
+    }
+    free(parser->names);
+    parser->names = names;
+    parser->names_size = size;
+  }
+  NameSlot* slot = probe_name(parser->names, parser->names_size, name);
+  if (!slot->name.str) {
+    slot->name = name;
+    slot->binder = NONE;
+    parser->names_count++;
+  }
+  return slot;
+}
+
+static Binder* find_or_add_global_var(Parser* parser, Name name) {
+  NameSlot* slot = find_name(parser, name);
+  if (slot->binder == NONE) {
+    grow_binders(parser, &parser->global_vars, parser->global_vars_count, &parser->global_vars_cap);
+    slot->binder = parser->global_vars_count++;
+    Binder* binder = &parser->global_vars[slot->binder];
+    binder->name = name;
+    binder->var = NONE;
+    binder->loc = NONE;
+    binder->shadow = NONE;
+  }
+  return &parser->global_vars[slot->binder];
+}
+
+// Bind a `$` name, which may have been used already.
+static void bind_global_var(Parser* parser, Name name, Term term) {
+  note_binder(parser, 0);
+  Binder* binder = find_or_add_global_var(parser, name);
+  if (binder->var != NONE) {
+    char error[256];
+    snprintf(error, sizeof(error), "Duplicate global variable binder: %.*s", (int)name.len, name.str);
+    parse_error(parser, error);
+  }
+  binder->var = term;
+}
+
+static void push_lexical_binder(Parser* parser, Name name, Term term) {
+  grow_binders(parser, &parser->lexical_vars, parser->lexical_vars_count, &parser->lexical_vars_cap);
+  NameSlot* slot = find_name(parser, name);
   Binder* binder = &parser->lexical_vars[parser->lexical_vars_count];
-  strncpy(binder->name, name, MAX_NAME_LEN - 1);
-  binder->name[MAX_NAME_LEN - 1] = '\0';
+  binder->name = name;
   binder->var = term;
   binder->loc = NONE;
-  parser->lexical_vars_count++;
+  binder->shadow = slot->binder;
+  slot->binder = parser->lexical_vars_count++;
 }
 
 static void pop_lexical_binder(Parser* parser) {
   if (parser->lexical_vars_count > 0) {
-    parser->lexical_vars_count--;
+    Binder* binder = &parser->lexical_vars[--parser->lexical_vars_count];
+    find_name(parser, binder->name)->binder = binder->shadow;
   }
 }
 
-static Binder* find_lexical_binder(Parser* parser, const char* name) {
-  for (int i = parser->lexical_vars_count - 1; i >= 0; i--) {
-    if (strcmp(parser->lexical_vars[i].name, name) == 0) {
-      return &parser->lexical_vars[i];
-    }
-  }
-  return NULL;
+static Binder* find_lexical_binder(Parser* parser, Name name) {
+  Val idx = find_name(parser, name)->binder;
+  return idx == NONE ? NULL : &parser->lexical_vars[idx];
+}
+
+// Note the occurrence of a binder's variable at a location.
+static void use_binder(Parser* parser, Binder* binder, bool global, Val loc) {
+  binder->loc = loc;
+  parser->last_binder = binder - (global ? parser->global_vars : parser->lexical_vars);
+  parser->last_global = global;
 }
 
 static void resolve_global_vars(Parser* parser) {
@@ -69,7 +189,7 @@ static void resolve_global_vars(Parser* parser) {
     Binder* binder = &parser->global_vars[i];
     if (binder->var == NONE) {
       char error[256];
-      snprintf(error, sizeof(error), "Undefined global variable: %s", binder->name);
+      snprintf(error, sizeof(error), "Undefined global variable: %.*s", (int)binder->name.len, binder->name.str);
       parse_error(parser, error);
     }
     if (binder->loc != NONE) {
@@ -78,15 +198,23 @@ static void resolve_global_vars(Parser* parser) {
   }
 }
 
-static void move_term(Parser* parser, Val from_loc, Val to_loc) {
+// Forget the `$` variables of a definition, which are local to it.
+static void clear_global_vars(Parser* parser) {
   for (size_t i = 0; i < parser->global_vars_count; i++) {
-    if (parser->global_vars[i].loc == from_loc) {
-      parser->global_vars[i].loc = to_loc;
-    }
+    find_name(parser, parser->global_vars[i].name)->binder = NONE;
   }
-  for (size_t i = 0; i < parser->lexical_vars_count; i++) {
-    if (parser->lexical_vars[i].loc == from_loc) {
-      parser->lexical_vars[i].loc = to_loc;
+  parser->global_vars_count = 0;
+  parser->last_binder = NONE;
+}
+
+// Move a parsed term to another location. A variable occurrence in it can
+// only be the last one parsed, so that is the only binder to update.
+static void move_term(Parser* parser, Val from_loc, Val to_loc) {
+  size_t count = parser->last_global ? parser->global_vars_count : parser->lexical_vars_count;
+  if (parser->last_binder < count) {
+    Binder* binder = &(parser->last_global ? parser->global_vars : parser->lexical_vars)[parser->last_binder];
+    if (binder->loc == from_loc) {
+      binder->loc = to_loc;
     }
   }
   parser->ic->heap[to_loc] = parser->ic->heap[from_loc];
@@ -105,16 +233,27 @@ bool consume(Parser* parser, const char* str) {
   return false;
 }
 
+// Print a parse error with the line it is on, and return to parse_string.
 void parse_error(Parser* parser, const char* message) {
   fprintf(stderr, "Parse error at line %zu, column %zu: %s\n", 
           parser->line, parser->col, message);
-  fprintf(stderr, "Input:\n%s\n", parser->input);
-  fprintf(stderr, "    ");
-  for (size_t i = 0; i < parser->pos && i < 40; i++) {
-    fprintf(stderr, " ");
+  const char* input = parser->input;
+  size_t start = parser->pos;
+  while (start > 0 && input[start - 1] != '\n') {
+    start--;
+  }
+  size_t end = parser->pos;
+  while (input[end] != '\0' && input[end] != '\n') {
+    end++;
+  }
+  fprintf(stderr, "%.*s\n", (int)(end - start), input + start);
+  for (size_t i = start; i < parser->pos; i++) {
+    if (((unsigned char)input[i] & 0xC0) != 0x80) { // One per UTF-8 character
+      fputc(input[i] == '\t' ? '\t' : ' ', stderr);
+    }
   }
   fprintf(stderr, "^\n");
-  exit(1);
+  longjmp(parser->fail, 1);
 }
 
 bool expect(Parser* parser, const char* token, const char* error_context) {
@@ -133,24 +272,46 @@ void init_parser(Parser* parser, IC* ic, const char* input) {
   parser->pos = 0;
   parser->line = 1;
   parser->col = 1;
+  parser->global_vars = NULL;
   parser->global_vars_count = 0;
+  parser->global_vars_cap = 0;
+  parser->lexical_vars = NULL;
   parser->lexical_vars_count = 0;
-}
-
-static void parse_name(Parser* parser, char* name) {
-  size_t i = 0;
+  parser->lexical_vars_cap = 0;
+  parser->names = NULL;
+  parser->names_count = 0;
+  parser->names_size = 0;
+  parser->last_binder = NONE;
+  parser->last_global = false;
+  parser->text = NULL;
+  parser->text_cap = 0;
+  parser->ctr_names = NULL;
+  parser->ctr_arities = NULL;
+  parser->ctr_cap = 0;
+  parser->lam_min_binder = NONE;
+  parser->lam_has_redex = false;
+}
+
+void free_parser(Parser* parser) {
+  free(parser->global_vars);
+  free(parser->lexical_vars);
+  free(parser->names);
+  free(parser->text);
+  free(parser->ctr_names);
+  free(parser->ctr_arities);
+}
+
+static Name parse_name(Parser* parser) {
   char c = peek_char(parser);
   if (!isalpha(c) && c != '_' && c != '$') {
     parse_error(parser, "Expected name starting with letter, underscore, or '$'");
   }
+  Name name = {parser->input + parser->pos, 0};
   while (isalnum(peek_char(parser)) || peek_char(parser) == '_' || peek_char(parser) == '$') {
-    if (i < MAX_NAME_LEN - 1) {
-      name[i++] = next_char(parser);
-    } else {
-      parse_error(parser, "Name too long");
-    }
+    next_char(parser);
+    name.len++;
   }
-  name[i] = '\0';
+  return name;
 }
 
 char next_char(Parser* parser) {
@@ -222,25 +383,26 @@ void consume_utf8(Parser* parser, int bytes) {
 
 // Term parsing functions
 static void parse_term_var(Parser* parser, Val loc) {
-  char name[MAX_NAME_LEN];
-  parse_name(parser, name);
+  Name name = parse_name(parser);
   if (starts_with_dollar(name)) {
-    size_t idx = find_or_add_global_var(parser, name);
-    if (parser->global_vars[idx].var == NONE) {
-      parser->global_vars[idx].loc = loc;
+    note_binder(parser, 0);
+    Binder* binder = find_or_add_global_var(parser, name);
+    if (binder->var == NONE) {
+      use_binder(parser, binder, true, loc);
     } else {
-      parser->ic->heap[loc] = parser->global_vars[idx].var;
+      parser->ic->heap[loc] = binder->var;
     }
   } else {
     Binder* binder = find_lexical_binder(parser, name);
     if (binder == NULL) {
       char error[256];
-      snprintf(error, sizeof(error), "Undefined lexical variable: %s", name);
+      snprintf(error, sizeof(error), "Undefined lexical variable: %.*s", (int)name.len, name.str);
       parse_error(parser, error);
     }
+    note_binder(parser, TERM_VAL(binder->var));
     if (binder->loc == NONE) {
       parser->ic->heap[loc] = binder->var;
-      binder->loc = loc;
+      use_binder(parser, binder, false, loc);
     } else {
       Val dup_loc = ic_alloc(parser->ic, 1);
       parser->ic->heap[dup_loc] = parser->ic->heap[binder->loc];
@@ -248,7 +410,7 @@ static void parse_term_var(Parser* parser, Val loc) {
       Term dp1 = ic_make_co1(0, dup_loc);
       parser->ic->heap[binder->loc] = dp0;
       parser->ic->heap[loc] = dp1;
-      binder->loc = loc;
+      use_binder(parser, binder, false, loc);
     }
   }
 }
@@ -259,38 +421,92 @@ static void parse_term_lam(Parser* parser, Val loc) {
   } else if (!consume(parser, "λ")) {
     parse_error(parser, "Expected 'λ' for lambda");
   }
-  char name[MAX_NAME_LEN];
-  parse_name(parser, name);
+  Name name = parse_name(parser);
   expect(parser, ".", "after name in lambda");
   Val lam_node = ic_alloc(parser->ic, 1);
   Term var_term = ic_make_term(VAR, 0, lam_node);
   if (starts_with_dollar(name)) {
-    size_t idx = find_or_add_global_var(parser, name);
-    if (parser->global_vars[idx].var != NONE) {
-      char error[256];
-      snprintf(error, sizeof(error), "Duplicate global variable binder: %s", name);
-      parse_error(parser, error);
-    }
-    parser->global_vars[idx].var = var_term;
+    bind_global_var(parser, name, var_term);
   } else {
     push_lexical_binder(parser, name, var_term);
   }
+  Val outer_min_binder = parser->lam_min_binder;
+  bool outer_has_redex = parser->lam_has_redex;
+  parser->lam_min_binder = NONE;
+  parser->lam_has_redex = false;
   parse_term(parser, lam_node);
   if (!starts_with_dollar(name)) {
     pop_lexical_binder(parser);
   }
-  store_term(parser, loc, LAM, 0, lam_node);
+
+  // The body was allocated right after the lambda's node. If its variables
+  // are all bound inside and it has no redexes, nothing outside the block
+  // points into it, and its size is kept in the label (see LAM_SIZE).
+  Val size = parser->ic->heap_pos - lam_node;
+  bool closed = parser->lam_min_binder >= lam_node && !parser->lam_has_redex;
+  Lab lab = closed && size <= LAM_SIZE_MAX ? (Lab)size : 0;
+  if (outer_min_binder < parser->lam_min_binder) {
+    parser->lam_min_binder = outer_min_binder;
+  }
+  parser->lam_has_redex = parser->lam_has_redex || outer_has_redex;
+  store_term(parser, loc, LAM, lab, lam_node);
+}
+
+// Match a binary operator after the first term of a parenthesized expression.
+// It must be followed by whitespace and a term, so that arguments such as
+// `+x` and a trailing `*` are still parsed as successors and erasures.
+static bool parse_oper(Parser* parser, Oper* op) {
+  const char* str = parser->input + parser->pos;
+  size_t len = 0;
+  for (int i = 0; i < OPER_COUNT; i++) {
+    const char* sym = ic_oper_symbol((Oper)i);
+    size_t sym_len = strlen(sym);
+    if (sym_len > len && strncmp(str, sym, sym_len) == 0 && isspace((unsigned char)str[sym_len])) {
+      len = sym_len;
+      *op = (Oper)i;
+    }
+  }
+  if (len == 0) {
+    return false;
+  }
+  size_t end = len;
+  while (isspace((unsigned char)str[end])) {
+    end++;
+  }
+  if (str[end] == ')' || str[end] == '\0') {
+    return false;
+  }
+  for (size_t i = 0; i < len; i++) {
+    next_char(parser);
+  }
+  return true;
+}
+
+static void parse_term_op2(Parser* parser, Val loc, Oper op) {
+  Val op2_node = ic_alloc(parser->ic, 3);
+  move_term(parser, loc, op2_node + 0);
+  parse_term(parser, op2_node + 1);
+  parser->ic->heap[op2_node + 2] = ic_make_num(OP2_INFO(op, 0));
+  note_head(parser, parser->ic->heap[op2_node + 0]);
+  store_term(parser, loc, OP2, 0, op2_node);
+  expect(parser, ")", "after binary operation");
 }
 
 static void parse_term_app(Parser* parser, Val loc) {
   expect(parser, "(", "for application");
   parse_term(parser, loc);
   skip(parser);
+  Oper op;
+  if (parse_oper(parser, &op)) {
+    parse_term_op2(parser, loc, op);
+    return;
+  }
   while (peek_char(parser) != ')') {
     Val app_node = ic_alloc(parser->ic, 2);
     move_term(parser, loc, app_node + 0);
     parse_term(parser, app_node + 1);
     store_term(parser, loc, APP, 0, app_node);
+    note_head(parser, parser->ic->heap[app_node + 0]);
     skip(parser);
   }
   expect(parser, ")", "after terms in application");
@@ -312,37 +528,24 @@ static void parse_term_dup(Parser* parser, Val loc) {
   expect(parser, "!&", "for duplication");
   Lab label = parse_uint(parser) & LAB_MAX;
   expect(parser, "{", "after label in duplication");
-  char x0[MAX_NAME_LEN];
-  char x1[MAX_NAME_LEN];
-  parse_name(parser, x0);
+  Name x0 = parse_name(parser);
   expect(parser, ",", "between names in duplication");
-  parse_name(parser, x1);
+  Name x1 = parse_name(parser);
   expect(parser, "}", "after names in duplication");
   expect(parser, "=", "after names in duplication");
   Val dup_node = ic_alloc(parser->ic, 1);
   parse_term(parser, dup_node);
+  note_head(parser, parser->ic->heap[dup_node]);
   expect(parser, ";", "after value in duplication");
   Term co0_term = ic_make_co0(label, dup_node);
   Term co1_term = ic_make_co1(label, dup_node);
   if (starts_with_dollar(x0)) {
-    size_t idx = find_or_add_global_var(parser, x0);
-    if (parser->global_vars[idx].var != NONE) {
-      char error[256];
-      snprintf(error, sizeof(error), "Duplicate global variable binder: %s", x0);
-      parse_error(parser, error);
-    }
-    parser->global_vars[idx].var = co0_term;
+    bind_global_var(parser, x0, co0_term);
   } else {
     push_lexical_binder(parser, x0, co0_term);
   }
   if (starts_with_dollar(x1)) {
-    size_t idx = find_or_add_global_var(parser, x1);
-    if (parser->global_vars[idx].var != NONE) {
-      char error[256];
-      snprintf(error, sizeof(error), "Duplicate global variable binder: %s", x1);
-      parse_error(parser, error);
-    }
-    parser->global_vars[idx].var = co1_term;
+    bind_global_var(parser, x1, co1_term);
   } else {
     push_lexical_binder(parser, x1, co1_term);
   }
@@ -369,6 +572,7 @@ static void parse_term_suc(Parser* parser, Val loc) {
   expect(parser, "+", "for successor");
   Val suc_node = ic_alloc(parser->ic, 1);
   parse_term(parser, suc_node);
+  note_head(parser, parser->ic->heap[suc_node]);
   store_term(parser, loc, SUC, 0, suc_node);
 }
 
@@ -376,6 +580,7 @@ static void parse_term_swi(Parser* parser, Val loc) {
   expect(parser, "?", "for switch");
   Val swi_node = ic_alloc(parser->ic, 3);
   parse_term(parser, swi_node);
+  note_head(parser, parser->ic->heap[swi_node]);
   expect(parser, "{", "after condition in switch");
   expect(parser, "0", "for zero case");
   expect(parser, ":", "after '0'");
@@ -389,10 +594,205 @@ static void parse_term_swi(Parser* parser, Val loc) {
   store_term(parser, loc, SWI, 0, swi_node);
 }
 
+static void parse_term_ctr(Parser* parser, Val loc) {
+  expect(parser, "#", "for constructor");
+  Name name = parse_name(parser);
+  Val cid = ic_ctr_find(parser->ic, name_text(parser, name));
+  if (cid == NONE) {
+    char error[256];
+    snprintf(error, sizeof(error), "Undeclared constructor: #%.*s", (int)name.len, name.str);
+    parse_error(parser, error);
+  }
+  Val ari = parser->ic->ctrs[cid].arity;
+  Val ctr_node = ari > 0 ? ic_alloc(parser->ic, ari) : 0;
+  if (ari > 0) {
+    expect(parser, "{", "after constructor name");
+    for (Val i = 0; i < ari; i++) {
+      parse_term(parser, ctr_node + i);
+      consume(parser, ",");
+    }
+    expect(parser, "}", "after constructor fields");
+  }
+  store_term(parser, loc, CTR, CTR_LAB(cid, ari), ctr_node);
+}
+
+static void parse_term_mat(Parser* parser, Val loc) {
+  expect(parser, "~", "for match");
+  Val val_loc = parse_term_alloc(parser);
+  expect(parser, "{", "after value in match");
+  expect(parser, "#", "for first case");
+  Name name = parse_name(parser);
+  Val cid = ic_ctr_find(parser->ic, name_text(parser, name));
+  if (cid == NONE) {
+    char error[256];
+    snprintf(error, sizeof(error), "Undeclared constructor: #%.*s", (int)name.len, name.str);
+    parse_error(parser, error);
+  }
+  Val first = parser->ic->ctrs[cid].first;
+  Val len = parser->ic->ctrs[cid].count;
+  Val mat_node = ic_alloc(parser->ic, len + 2);
+  move_term(parser, val_loc, mat_node + 0);
+  store_term(parser, val_loc, ERA, 0, 0);
+  note_head(parser, parser->ic->heap[mat_node + 0]);
+  parser->ic->heap[mat_node + 1] = ic_make_num(first);
+  for (Val i = 0; i < len; i++) {
+    if (i > 0) {
+      expect(parser, "#", "for case");
+      name = parse_name(parser);
+    }
+    if (!name_is(name, parser->ic->ctrs[first + i].name)) {
+      char error[256];
+      snprintf(error, sizeof(error), "Expected case #%s", parser->ic->ctrs[first + i].name);
+      parse_error(parser, error);
+    }
+    expect(parser, ":", "after constructor in case");
+    parse_term(parser, mat_node + 2 + i);
+    expect(parser, ";", "after case");
+  }
+  expect(parser, "}", "to close match");
+  store_term(parser, loc, MAT, (Lab)len, mat_node);
+}
+
+// Parse `data Name { #A #B{x y} ... }`, declaring its constructors in order.
+static void parse_data(Parser* parser) {
+  expect(parser, "data", "for data type");
+  skip(parser);
+  parse_name(parser);
+  expect(parser, "{", "after data type name");
+  Val count = 0;
+  while (!consume(parser, "}")) {
+    if (parser->ic->ctr_count + count >= IC_CTR_MAX) {
+      parse_error(parser, "Too many constructors");
+    }
+    if (count == parser->ctr_cap) {
+      size_t cap = parser->ctr_cap ? parser->ctr_cap * 2 : 16;
+      Name* names = (Name*)realloc(parser->ctr_names, cap * sizeof(Name));
+      if (names) {
+        parser->ctr_names = names;
+      }
+      Val* arities = (Val*)realloc(parser->ctr_arities, cap * sizeof(Val));
+      if (arities) {
+        parser->ctr_arities = arities;
+      }
+      if (!names || !arities) {
+        parse_error(parser, "Memory allocation failed");
+      }
+      parser->ctr_cap = cap;
+    }
+    expect(parser, "#", "for constructor declaration");
+    Name name = parse_name(parser);
+    if (ic_ctr_find(parser->ic, name_text(parser, name)) != NONE) {
+      char error[256];
+      snprintf(error, sizeof(error), "Duplicate constructor: #%.*s", (int)name.len, name.str);
+      parse_error(parser, error);
+    }
+    Val arity = 0;
+    if (consume(parser, "{")) {
+      while (!consume(parser, "}")) {
+        skip(parser);
+        parse_name(parser);
+        consume(parser, ",");
+        arity++;
+      }
+      if (arity > IC_CTR_MAX_ARITY) {
+        parse_error(parser, "Too many constructor fields");
+      }
+    }
+    parser->ctr_names[count] = name;
+    parser->ctr_arities[count] = arity;
+    count++;
+  }
+
+  const char** names = (const char**)malloc((count ? count : 1) * sizeof(char*));
+  bool ok = names != NULL;
+  for (Val i = 0; ok && i < count; i++) {
+    names[i] = name_dup(parser->ctr_names[i]);
+    ok = names[i] != NULL;
+    if (!ok) {
+      count = i;
+    }
+  }
+  Val first = ok ? ic_ctr_declare(parser->ic, names, parser->ctr_arities, count) : NONE;
+  for (Val i = 0; names && i < count; i++) {
+    free((char*)names[i]);
+  }
+  free(names);
+  if (first == NONE) {
+    parse_error(parser, ok ? "Too many constructors" : "Memory allocation failed");
+  }
+}
+
+static void parse_term_ref(Parser* parser, Val loc) {
+  expect(parser, "@", "for reference");
+  Name name = parse_name(parser);
+  Val id = ic_def_declare(parser->ic, name_text(parser, name));
+  if (id == NONE || id > TERM_VAL_MASK) {
+    parse_error(parser, "Too many definitions");
+  }
+  store_term(parser, loc, REF, 0, id);
+}
+
+// Parse `@name = term`, storing the term in the book. It is parsed on the
+// heap like any other term, and the heap is rewound once it is copied out.
+// Its `$` variables must be bound within the definition.
+static void parse_def(Parser* parser) {
+  expect(parser, "@", "for definition");
+  Name name = parse_name(parser);
+  expect(parser, "=", "after definition name");
+  Val id = ic_def_declare(parser->ic, name_text(parser, name));
+  if (id == NONE || id > TERM_VAL_MASK) {
+    parse_error(parser, "Too many definitions");
+  }
+  if (parser->ic->defs[id].terms) {
+    char error[256];
+    snprintf(error, sizeof(error), "Duplicate definition: @%.*s", (int)name.len, name.str);
+    parse_error(parser, error);
+  }
+  Val start = parser->ic->heap_pos;
+  Val root_loc = parse_term_alloc(parser);
+  resolve_global_vars(parser);
+  clear_global_vars(parser);
+  if (!ic_def_set(parser->ic, id, start, parser->ic->heap_pos, parser->ic->heap[root_loc])) {
+    parse_error(parser, "Memory allocation failed for definition");
+  }
+  parser->ic->heap_pos = start;
+}
+
+// Check for a definition (`@name =`) at the current position.
+static bool peek_def(Parser* parser) {
+  size_t i = parser->pos;
+  if (parser->input[i] != '@') {
+    return false;
+  }
+  i++;
+  while (isalnum((unsigned char)parser->input[i]) || parser->input[i] == '_' || parser->input[i] == '$') {
+    i++;
+  }
+  while (isspace((unsigned char)parser->input[i])) {
+    i++;
+  }
+  return parser->input[i] == '=';
+}
+
+// Check that every referenced definition was defined.
+static void check_defs(Parser* parser) {
+  for (Val i = 0; i < parser->ic->def_count; i++) {
+    if (!parser->ic->defs[i].terms) {
+      char error[256];
+      snprintf(error, sizeof(error), "Undefined reference: @%s", parser->ic->defs[i].name);
+      parse_error(parser, error);
+    }
+  }
+}
+
+// Check for a `data` keyword at the current position.
+static bool peek_data(Parser* parser) {
+  return strncmp(parser->input + parser->pos, "data", 4) == 0 && isspace((unsigned char)parser->input[parser->pos + 4]);
+}
+
 static void parse_term_let(Parser* parser, Val loc) {
   expect(parser, "!", "for let expression");
-  char name[MAX_NAME_LEN];
-  parse_name(parser, name);
+  Name name = parse_name(parser);
   expect(parser, "=", "after name in let expression");
   Val app_node = ic_alloc(parser->ic, 2);
   Val lam_node = ic_alloc(parser->ic, 1);
@@ -400,13 +800,7 @@ static void parse_term_let(Parser* parser, Val loc) {
   expect(parser, ";", "after value in let expression");
   Term var_term = ic_make_term(VAR, 0, lam_node);
   if (starts_with_dollar(name)) {
-    size_t idx = find_or_add_global_var(parser, name);
-    if (parser->global_vars[idx].var != NONE) {
-      char error[256];
-      snprintf(error, sizeof(error), "Duplicate global variable binder: %s", name);
-      parse_error(parser, error);
-    }
-    parser->global_vars[idx].var = var_term;
+    bind_global_var(parser, name, var_term);
   } else {
     push_lexical_binder(parser, name, var_term);
   }
@@ -416,6 +810,7 @@ static void parse_term_let(Parser* parser, Val loc) {
   }
   store_term(parser, app_node + 0, LAM, 0, lam_node);
   store_term(parser, loc, APP, 0, app_node);
+  note_head(parser, parser->ic->heap[app_node + 0]);
 }
 
 void parse_term(Parser* parser, Val loc) {
@@ -451,6 +846,16 @@ void parse_term(Parser* parser, Val loc) {
     parse_term_suc(parser, loc);
   } else if (c == '?') {
     parse_term_swi(parser, loc);
+  } else if (c == '@' && !IC_HAS_REF) {
+    parse_error(parser, "Definitions need the 64-bit build");
+  } else if (c == '@') {
+    parse_term_ref(parser, loc);
+  } else if ((c == '#' || c == '~') && !IC_HAS_CTR) {
+    parse_error(parser, "Data types need the 64-bit build");
+  } else if (c == '#') {
+    parse_term_ctr(parser, loc);
+  } else if (c == '~') {
+    parse_term_mat(parser, loc);
   } else {
     char error_msg[100];
     snprintf(error_msg, sizeof(error_msg), "Unexpected character: %c (code: %d)", c, (int)c);
@@ -464,20 +869,59 @@ Val parse_term_alloc(Parser* parser) {
   return loc;
 }
 
+// Parse the data types and definitions of a source, then its term.
+static Term parse_program(Parser* parser) {
+  skip(parser);
+  while (peek_data(parser) || peek_def(parser)) {
+    if (peek_data(parser)) {
+      if (!IC_HAS_CTR) {
+        parse_error(parser, "Data types need the 64-bit build");
+      }
+      parse_data(parser);
+    } else {
+      if (!IC_HAS_REF) {
+        parse_error(parser, "Definitions need the 64-bit build");
+      }
+      parse_def(parser);
+    }
+    skip(parser);
+  }
+
+  // A file with only definitions runs @main
+  Term term;
+  if (parser->input[parser->pos] == '\0' && parser->ic->def_count > 0) {
+    Val main_id = ic_def_declare(parser->ic, "main");
+    if (main_id == NONE) {
+      parse_error(parser, "Too many definitions");
+    }
+    term = ic_make_ref(main_id);
+  } else {
+    Val term_loc = parse_term_alloc(parser);
+    resolve_global_vars(parser);
+    term = parser->ic->heap[term_loc];
+  }
+  check_defs(parser);
+  return term;
+}
+
 Term parse_string(IC* ic, const char* input) {
   Parser parser;
   init_parser(&parser, ic, input);
-  skip(&parser);
-  Val term_loc = parse_term_alloc(&parser);
-  resolve_global_vars(&parser);
-  return parser.ic->heap[term_loc];
+  Term term;
+  if (setjmp(parser.fail) == 0) {
+    term = parse_program(&parser);
+  } else {
+    term = NONE;
+  }
+  free_parser(&parser);
+  return term;
 }
 
 Term parse_file(IC* ic, const char* filename) {
   FILE* file = fopen(filename, "r");
   if (!file) {
     fprintf(stderr, "Error: Could not open file '%s'\n", filename);
-    exit(1);
+    return NONE;
   }
   fseek(file, 0, SEEK_END);
   long size = ftell(file);
@@ -486,7 +930,7 @@ Term parse_file(IC* ic, const char* filename) {
   if (!buffer) {
     fprintf(stderr, "Error: Memory allocation failed\n");
     fclose(file);
-    exit(1);
+    return NONE;
   }
   size_t read_size = fread(buffer, 1, size, file);
   fclose(file);
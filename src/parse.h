@@ -2,19 +2,31 @@
 #define PARSE_H
 
 #include "ic.h"
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdint.h>
 
-#define MAX_NAME_LEN 64
-#define MAX_GLOBAL_VARS 1024
-#define MAX_LEXICAL_VARS 1024
+// A name, pointing into the input.
+typedef struct {
+  const char* str;
+  size_t len;
+} Name;
 
 typedef struct {
-  char name[MAX_NAME_LEN];
-  Term var;
-  Val loc;
+  Name name;
+  Term var;      // The variable it binds (NONE for a `$` name not bound yet)
+  Val loc;       // Location of its last occurrence (NONE if not used yet)
+  Val shadow;    // Lexical binder of the same name it hides (NONE if none)
 } Binder;
 
+// Slot of the name table: a name and its innermost binder, indexing
+// global_vars for `$` names and lexical_vars for others. Names are never
+// removed, so a slot whose binder went out of scope holds NONE.
+typedef struct {
+  Name name;
+  Val binder;
+} NameSlot;
+
 typedef struct {
   IC* ic;
   const char* input;
@@ -22,15 +34,52 @@ typedef struct {
   size_t line;
   size_t col;
 
-  Binder global_vars[MAX_GLOBAL_VARS];
+  Binder* global_vars;
   size_t global_vars_count;
+  size_t global_vars_cap;
 
-  Binder lexical_vars[MAX_LEXICAL_VARS];
+  Binder* lexical_vars;
   size_t lexical_vars_count;
+  size_t lexical_vars_cap;
+
+  // Open-addressing hash table of every name met, sized a power of 2
+  NameSlot* names;
+  size_t names_count;
+  size_t names_size;
+
+  // The binder whose variable was used last, the only one a term being
+  // moved can hold an occurrence of (see move_term)
+  Val last_binder;
+  bool last_global;
+
+  char* text;          // Scratch buffer for names passed to the context
+  size_t text_cap;
+
+  // Constructors of the data type being declared
+  Name* ctr_names;
+  Val* ctr_arities;
+  size_t ctr_cap;
+
+  jmp_buf fail;        // Where parse errors return to
+
+  // Since the start of the innermost lambda: the lowest binder location its
+  // variables refer to, and whether a redex was parsed (see parse_term_lam)
+  Val lam_min_binder;
+  bool lam_has_redex;
 } Parser;
 
 void init_parser(Parser* parser, IC* ic, const char* input);
+void free_parser(Parser* parser);
+
+// Parse a term, after any data types and definitions, which are added to the
+// context. A source of only definitions parses to a reference to @main.
+// @param ic The IC context
+// @param input The source
+// @return The term, or NONE after printing a parse error
 Term parse_string(IC* ic, const char* input);
+
+// Parse a file with parse_string.
+// @return The term, or NONE after printing an error
 Term parse_file(IC* ic, const char* filename);
 
 #endif // PARSE_H
@@ -18,6 +18,11 @@ static Val get_num_val(Term term) {
   }
 }
 
+// Get the name of a constructor
+static const char* get_ctr_name(IC* ic, Val cid) {
+  return cid < ic->ctr_count ? ic->ctrs[cid].name : "?";
+}
+
 // Maximum string length for term representation
 #define MAX_STR_LEN 65536
 
@@ -198,7 +203,7 @@ void assign_var_ids(IC* ic, Term term, VarNameTable* var_table, DupTable* dup_ta
       assign_var_ids(ic, ic_clear_sub(subst), var_table, dup_table);
     } else {
       if (register_duplication(dup_table, loc, lab)) {
-        assign_var_ids(ic, subst, var_table, dup_table);
+        assign_var_ids(ic, ic->heap[ic_dup_node(ic, loc)], var_table, dup_table);
       }
     }
 
@@ -233,6 +238,22 @@ void assign_var_ids(IC* ic, Term term, VarNameTable* var_table, DupTable* dup_ta
     assign_var_ids(ic, ic->heap[swi_loc + 1], var_table, dup_table); // Zero branch
     assign_var_ids(ic, ic->heap[swi_loc + 2], var_table, dup_table); // Successor branch
 
+  } else if (tag == OP2) {
+    Val op2_loc = val;
+    assign_var_ids(ic, ic->heap[op2_loc], var_table, dup_table);
+    assign_var_ids(ic, ic->heap[op2_loc + 1], var_table, dup_table);
+
+  } else if (IS_CTR(tag)) {
+    for (Val i = 0; i < CTR_ARI(term); i++) {
+      assign_var_ids(ic, ic->heap[val + i], var_table, dup_table);
+    }
+
+  } else if (IS_MAT(tag)) {
+    assign_var_ids(ic, ic->heap[val], var_table, dup_table); // Scrutinee
+    for (Val i = 0; i < MAT_LEN(term); i++) {
+      assign_var_ids(ic, ic->heap[val + 2 + i], var_table, dup_table);
+    }
+
   } else {
     // Unknown tag, so nothing to do
   }
@@ -251,7 +272,7 @@ void stringify_duplications(IC* ic, DupTable* dup_table, VarNameTable* var_table
   for (uint32_t i = 0; i < dup_table->count; i++) {
     Val dup_loc = dup_table->locations[i];
     Lab lab = dup_table->labels[i];
-    Term val_term = ic->heap[dup_loc];
+    Term val_term = ic->heap[ic_dup_node(ic, dup_loc)];
 
     // Get variable names
     char* var0 = get_var_name(var_table, dup_loc, DP0);
@@ -335,7 +356,7 @@ void stringify_term(IC* ic, Term term, VarNameTable* var_table, char* buffer, in
     *pos += snprintf(buffer + *pos, max_len - *pos, "}");
 
   } else if (tag == NUM) {
-    *pos += snprintf(buffer + *pos, max_len - *pos, "%u", val & TERM_VAL_MASK);
+    *pos += snprintf(buffer + *pos, max_len - *pos, "%llu", (unsigned long long)(val & TERM_VAL_MASK));
 
   } else if (tag == SUC) {
     *pos += snprintf(buffer + *pos, max_len - *pos, "+");
@@ -350,6 +371,46 @@ void stringify_term(IC* ic, Term term, VarNameTable* var_table, char* buffer, in
     stringify_term(ic, ic->heap[val + 2], var_table, buffer, pos, max_len, prefix);
     *pos += snprintf(buffer + *pos, max_len - *pos, ";}");
 
+  } else if (tag == OP2) {
+    // Operands are swapped once the left one is a number (phase 1)
+    Term info = ic->heap[val + 2];
+    Val lft = OP2_PHASE(info) == 0 ? val : val + 1;
+    Val rgt = OP2_PHASE(info) == 0 ? val + 1 : val;
+    *pos += snprintf(buffer + *pos, max_len - *pos, "(");
+    stringify_term(ic, ic->heap[lft], var_table, buffer, pos, max_len, prefix);
+    *pos += snprintf(buffer + *pos, max_len - *pos, " %s ", ic_oper_symbol(OP2_OPER(info)));
+    stringify_term(ic, ic->heap[rgt], var_table, buffer, pos, max_len, prefix);
+    *pos += snprintf(buffer + *pos, max_len - *pos, ")");
+
+  } else if (IS_CTR(tag)) {
+    *pos += snprintf(buffer + *pos, max_len - *pos, "#%s", get_ctr_name(ic, CTR_CID(term)));
+    if (CTR_ARI(term) > 0) {
+      *pos += snprintf(buffer + *pos, max_len - *pos, "{");
+      for (Val i = 0; i < CTR_ARI(term); i++) {
+        if (i > 0) {
+          *pos += snprintf(buffer + *pos, max_len - *pos, ",");
+        }
+        stringify_term(ic, ic->heap[val + i], var_table, buffer, pos, max_len, prefix);
+      }
+      *pos += snprintf(buffer + *pos, max_len - *pos, "}");
+    }
+
+  } else if (IS_REF(tag)) {
+    Val id = TERM_VAL(term);
+    *pos += snprintf(buffer + *pos, max_len - *pos, "@%s", id < ic->def_count ? ic->defs[id].name : "?");
+
+  } else if (IS_MAT(tag)) {
+    Val first = TERM_VAL(ic->heap[val + 1]);
+    *pos += snprintf(buffer + *pos, max_len - *pos, "~");
+    stringify_term(ic, ic->heap[val], var_table, buffer, pos, max_len, prefix);
+    *pos += snprintf(buffer + *pos, max_len - *pos, "{");
+    for (Val i = 0; i < MAT_LEN(term); i++) {
+      *pos += snprintf(buffer + *pos, max_len - *pos, "#%s:", get_ctr_name(ic, first + i));
+      stringify_term(ic, ic->heap[val + 2 + i], var_table, buffer, pos, max_len, prefix);
+      *pos += snprintf(buffer + *pos, max_len - *pos, ";");
+    }
+    *pos += snprintf(buffer + *pos, max_len - *pos, "}");
+
   } else {
     *pos += snprintf(buffer + *pos, max_len - *pos, "<?unknown term>");
   }